@@ -1,10 +1,19 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
 #include "assert.h"
 #include "compress40.h"
+#include "fixed40.h"
+#include "parallel40.h"
+#include "stream40.h"
 
 static void (*compress_or_decompress)(FILE *input) = compress40;
+static bool streaming = false;
+static bool threaded = false;
+
+static void usage(const char *progname);
+static int parse_threads(const char *arg, const char *progname);
 
 int main(int argc, char *argv[])
 {
@@ -15,20 +24,36 @@ int main(int argc, char *argv[])
                         compress_or_decompress = compress40;
                 } else if (strcmp(argv[i], "-d") == 0) {
                         compress_or_decompress = decompress40;
+                } else if (strcmp(argv[i], "-f") == 0) {
+                        fixed40_set_enabled(true);
+                } else if (strcmp(argv[i], "-s") == 0) {
+                        streaming = true;
+                } else if (strcmp(argv[i], "-j") == 0) {
+                        if (i + 1 >= argc) {
+                                usage(argv[0]);
+                        }
+                        parallel40_set_threads(parse_threads(argv[++i],
+                                                             argv[0]));
+                        threaded = true;
                 } else if (*argv[i] == '-') {
                         fprintf(stderr, "%s: unknown option '%s'\n",
                                 argv[0], argv[i]);
                         exit(1);
                 } else if (argc - i > 2) {
-                        fprintf(stderr, "Usage: %s -d [filename]\n"
-                                "       %s -c [filename]\n",
-                                argv[0], argv[0]);
-                        exit(1);
+                        usage(argv[0]);
                 } else {
                         break;
                 }
         }
         assert(argc - i <= 1);    /* at most one file on command line */
+        if (streaming && threaded) {
+                usage(argv[0]);   /* -s runs on one thread */
+        }
+        if (streaming) {
+                compress_or_decompress = compress_or_decompress == compress40 ?
+                                         stream_compress40 : 
+                                         stream_decompress40;
+        }
         if (i < argc) {
                 FILE *fp = fopen(argv[i], "r");
                 assert(fp != NULL);
@@ -40,3 +65,26 @@ int main(int argc, char *argv[])
 
         return EXIT_SUCCESS; 
 }
+
+/* prints how to run the program and exits */
+static void usage(const char *progname)
+{
+        fprintf(stderr, "Usage: %s -d [-f] [-s | -j threads] [filename]\n"
+                "       %s -c [-f] [-s | -j threads] [filename]\n"
+                "       (threads is 1 to %d)\n",
+                progname, progname, PARALLEL40_MAX_THREADS);
+        exit(1);
+}
+
+/* returns the thread count given to -j, or exits with the usage message */
+static int parse_threads(const char *arg, const char *progname)
+{
+        char *end;
+        long threads = strtol(arg, &end, 10);
+
+        if (end == arg || *end != '\0' || threads < 1 || 
+            threads > PARALLEL40_MAX_THREADS) {
+                usage(progname);
+        }
+        return (int)threads;
+}
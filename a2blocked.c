@@ -1,7 +1,9 @@
 #include <string.h>
 
 #include <a2blocked.h>
+#include "a2extra.h"
 #include "uarray2b.h"
+#include "uarray2b_quads.h"
 
 // define a private version of each function in A2Methods_T that we implement
 
@@ -72,6 +74,11 @@ static void small_map_block_major(A2 a2, A2Methods_smallapplyfun apply,
     UArray2b_map(a2, apply_small, &mycl);
 }
 
+static void map_quads(A2 array2, A2Extra_quadfun apply, void *cl)
+{
+    UArray2b_map_quads(array2, (UArray2b_quadfun *) apply, cl);
+}
+
 static struct A2Methods_T uarray2_methods_blocked_struct = {
     new,
     new_with_blocksize,
@@ -94,3 +101,12 @@ static struct A2Methods_T uarray2_methods_blocked_struct = {
 // finally the payoff: here is the exported pointer to the struct
 
 A2Methods_T uarray2_methods_blocked = &uarray2_methods_blocked_struct;
+
+// rows of a blocked array are not contiguous, so there is no map_rows
+
+static struct A2Extra_T uarray2_extra_blocked_struct = {
+    NULL,                       // map_rows
+    map_quads,
+};
+
+A2Extra_T uarray2_extra_blocked = &uarray2_extra_blocked_struct;
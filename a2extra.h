@@ -0,0 +1,51 @@
+/*
+ * a2extra.h
+ * Purpose: Interface to methods which go with an A2Methods_T suite but are
+ *          not part of the course's A2Methods interface, such as mapping
+ *          over whole rows or 2x2 groups of elements at a time. A method is
+ *          NULL if the representation cannot provide it cheaply.
+ */
+#ifndef A2EXTRA_INCLUDED
+#define A2EXTRA_INCLUDED
+
+#include "a2methods.h"
+
+/*
+ * A2Extra_rowfun
+ * Work to perform on one row: first points at the element in column 0, and
+ * the count elements of the row follow it contiguously
+ */
+typedef void A2Extra_rowfun(int row, A2Methods_Object *first, int count, 
+                            void *cl);
+
+/*
+ * A2Extra_quadfun
+ * Work to perform on the 2x2 group of elements whose top left element is at
+ * column 2 * col, row 2 * row
+ */
+typedef void A2Extra_quadfun(int col, int row, A2Methods_Object *tl, 
+                             A2Methods_Object *tr, A2Methods_Object *ll, 
+                             A2Methods_Object *lr, void *cl);
+
+typedef const struct A2Extra_T {
+    /* calls apply once for each row, from row 0 down */
+    void (*map_rows)(A2Methods_UArray2 array2, A2Extra_rowfun apply, 
+                     void *cl);
+    /* 
+     * calls apply once for each 2x2 group, in the order the representation 
+     * stores them; a last column or row of odd width or height is skipped
+     */
+    void (*map_quads)(A2Methods_UArray2 array2, A2Extra_quadfun apply,
+                      void *cl);
+} *A2Extra_T;
+
+/* extra methods for the arrays of uarray2_methods_plain */
+extern A2Extra_T uarray2_extra_plain;
+
+/* extra methods for the arrays of uarray2_methods_blocked */
+extern A2Extra_T uarray2_extra_blocked;
+
+/* extra methods for the arrays of uarray2_methods_morton */
+extern A2Extra_T uarray2_extra_morton;
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * a2morton.c
+ * Purpose: Implements an A2Methods_T method suite, and its A2Extra_T 
+ *          methods, using the Morton (Z-order) UArray2m as its 
+ *          two-dimensional array representation
+ */
+
+#include <stddef.h>
+
+#include "assert.h"
+#include "a2morton.h"
+#include "a2extra.h"
+#include "uarray2m.h"
+
+// define a private version of each function in A2Methods_T that we implement
+
+typedef A2Methods_UArray2 A2;   // private abbreviation
+
+static A2 new(int width, int height, int size)
+{
+    return UArray2m_new(width, height, size);
+}
+
+static A2 new_with_blocksize(int width, int height, int size, int blocksize)
+{
+    (void)blocksize;
+    return UArray2m_new(width, height, size);
+}
+
+static void a2free(A2 *array2p)
+{
+    UArray2m_free((UArray2m_T *) array2p);
+}
+
+static int width(A2 array2)
+{
+    return UArray2m_width(array2);
+}
+static int height(A2 array2)
+{
+    return UArray2m_height(array2);
+}
+static int size(A2 array2)
+{
+    return UArray2m_size(array2);
+}
+static int blocksize(A2 array2)
+{
+    assert(array2 != NULL);
+    return 0;
+}
+
+static A2Methods_Object *at(A2 array2, int i, int j)
+{
+    return UArray2m_at(array2, i, j);
+}
+
+/* 
+ * row and column passes go through at; every index is a few shifts (or two
+ * PDEPs), and consecutive cells share their cache lines along both axes
+ */
+static void map_row_major(A2 array2, A2Methods_applyfun apply, void *cl)
+{
+    assert(array2 != NULL && apply != NULL);
+    int w = UArray2m_width(array2);
+    int h = UArray2m_height(array2);
+    for (int j = 0; j < h; j++) {
+        for (int i = 0; i < w; i++) {
+            apply(i, j, array2, UArray2m_at(array2, i, j), cl);
+        }
+    }
+}
+
+static void map_col_major(A2 array2, A2Methods_applyfun apply, void *cl)
+{
+    assert(array2 != NULL && apply != NULL);
+    int w = UArray2m_width(array2);
+    int h = UArray2m_height(array2);
+    for (int i = 0; i < w; i++) {
+        for (int j = 0; j < h; j++) {
+            apply(i, j, array2, UArray2m_at(array2, i, j), cl);
+        }
+    }
+}
+
+typedef void applyfun(int i, int j, UArray2m_T array2m, void *elem, void *cl);
+
+static void map_z_order(A2 array2, A2Methods_applyfun apply, void *cl)
+{
+    UArray2m_map(array2, (applyfun *) apply, cl);
+}
+
+struct small_closure {
+    A2Methods_smallapplyfun *apply;
+    void *cl;
+};
+
+static void apply_small(int i, int j, A2 array2, void *elem, void *vcl)
+{
+    struct small_closure *cl = vcl;
+    (void)i;
+    (void)j;
+    (void)array2;
+    cl->apply(elem, cl->cl);
+}
+
+static void small_map_row_major(A2 a2, A2Methods_smallapplyfun apply,
+                                void *cl)
+{
+    struct small_closure mycl = { apply, cl };
+    map_row_major(a2, apply_small, &mycl);
+}
+
+static void small_map_col_major(A2 a2, A2Methods_smallapplyfun apply,
+                                void *cl)
+{
+    struct small_closure mycl = { apply, cl };
+    map_col_major(a2, apply_small, &mycl);
+}
+
+static void small_map_z_order(A2 a2, A2Methods_smallapplyfun apply, void *cl)
+{
+    struct small_closure mycl = { apply, cl };
+    map_z_order(a2, apply_small, &mycl);
+}
+
+static void map_quads(A2 array2, A2Extra_quadfun apply, void *cl)
+{
+    UArray2m_map_quads(array2, (UArray2m_quadfun *) apply, cl);
+}
+
+static struct A2Methods_T uarray2_methods_morton_struct = {
+    new,
+    new_with_blocksize,
+    a2free,
+    width,
+    height,
+    size,
+    blocksize,
+    at,
+    map_row_major,
+    map_col_major,
+    map_z_order,                // map_block_major
+    map_z_order,                // map_default
+    small_map_row_major,
+    small_map_col_major,
+    small_map_z_order,          // small_map_block_major
+    small_map_z_order,          // small_map_default
+};
+
+// finally the payoff: here is the exported pointer to the struct
+
+A2Methods_T uarray2_methods_morton = &uarray2_methods_morton_struct;
+
+// rows of a Z-order array are not contiguous, so there is no map_rows
+
+static struct A2Extra_T uarray2_extra_morton_struct = {
+    NULL,                       // map_rows
+    map_quads,
+};
+
+A2Extra_T uarray2_extra_morton = &uarray2_extra_morton_struct;
@@ -0,0 +1,17 @@
+/*
+ * a2morton.h
+ * Purpose: Interface to an A2Methods_T method suite whose arrays are stored
+ *          in Morton (Z-order), which is local along rows and columns alike
+ */
+#ifndef A2MORTON_INCLUDED
+#define A2MORTON_INCLUDED
+
+#include "a2methods.h"
+
+/* 
+ * the block-major and default maps visit elements in Z-order; blocksize is
+ * 0, as for plain arrays, since no blocksize is chosen
+ */
+extern A2Methods_T uarray2_methods_morton;
+
+#endif
@@ -13,7 +13,9 @@
 
 #include "assert.h"
 #include "a2plain.h"
+#include "a2extra.h"
 #include "uarray2.h"
+#include "uarray2_rows.h"
 
 /************************************************/
 /* Define a private version of each function in */
@@ -163,6 +165,46 @@ static void small_map_col_major(A2Methods_UArray2 a2,
     UArray2_map_col_major(a2, apply_small, &mycl);
 }
 
+/* map_rows
+ * Purpose: Calls apply once for each row of the array with a pointer to the
+ *              row's first element and the length of the row
+ * Inputs:  UArray2 to map over, function to apply to each row, closure
+ * Outputs: For valid inputs, void
+ *          For invalid inputs (null array or function), CRE and program exits
+ */
+static void map_rows(A2Methods_UArray2 uarray2, A2Extra_rowfun apply, 
+                     void *cl)
+{
+    assert(uarray2 != NULL);
+    UArray2_map_rows(uarray2, (UArray2_applyrowfun *)apply, cl);
+}
+
+/* map_quads
+ * Purpose: Calls apply once for each 2x2 group of elements, going along each
+ *              pair of rows with pointers into both rows
+ * Inputs:  UArray2 to map over, function to apply to each group, closure
+ * Outputs: For valid inputs, void
+ *          For invalid inputs (null array or function), CRE and program exits
+ */
+static void map_quads(A2Methods_UArray2 uarray2, A2Extra_quadfun apply,
+                      void *cl)
+{
+    assert(uarray2 != NULL && apply != NULL);
+    int quads_width = UArray2_width(uarray2) / 2;
+    int quads_height = UArray2_height(uarray2) / 2;
+    size_t size = UArray2_size(uarray2);
+
+    for (int row = 0; row < quads_height && quads_width > 0; row++) {
+        /* rows are contiguous, so each group is two pairs of neighbours */
+        char *top = UArray2_at(uarray2, 0, 2 * row);
+        char *bottom = UArray2_at(uarray2, 0, 2 * row + 1);
+        for (int col = 0; col < quads_width; col++) {
+            apply(col, row, top, top + size, bottom, bottom + size, cl);
+            top += 2 * size;
+            bottom += 2 * size;
+        }
+    }
+}
 
 static struct A2Methods_T uarray2_methods_plain_struct = {
     new,
@@ -185,3 +227,10 @@ static struct A2Methods_T uarray2_methods_plain_struct = {
 
 // finally the payoff: here is the exported pointer to the struct
 A2Methods_T uarray2_methods_plain = &uarray2_methods_plain_struct;
+
+static struct A2Extra_T uarray2_extra_plain_struct = {
+    map_rows,
+    map_quads,
+};
+
+A2Extra_T uarray2_extra_plain = &uarray2_extra_plain_struct;
@@ -0,0 +1,171 @@
+/*
+ * alloctest.c
+ * Purpose: Checks that decompression does no heap allocation per pixel. The
+ *          Makefile links this program with malloc, calloc and realloc
+ *          wrapped (-Wl,--wrap=...), so every call the decoders make while a
+ *          synthetic image is decoded is counted.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "assert.h"
+#include "a2plain.h"
+#include "pnm.h"
+#include "convert40.h"
+#include "pack40.h"
+#include "simd40.h"
+#include "fixed40.h"
+
+#define US_TYPE uint64_t
+
+#define WIDTH 640
+#define HEIGHT 480
+#define DENOMINATOR 255
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static long allocations = 0;
+
+void make_words(US_TYPE *words);
+void test_cv_to_rgb(const US_TYPE *words);
+void test_decode_row(const US_TYPE *words);
+void check_allocations(const char *what);
+
+int main()
+{
+    US_TYPE *words = malloc(sizeof(*words) * (WIDTH / 2) * (HEIGHT / 2));
+    assert(words != NULL);
+    make_words(words);
+
+    printf("Testing cv_to_rgb ...\n");
+    test_cv_to_rgb(words);
+    printf("Testing decode_row ...\n");
+    test_decode_row(words);
+
+    free(words);
+    exit(EXIT_SUCCESS);
+}
+
+void *__wrap_malloc(size_t size)
+{
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    allocations++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    allocations++;
+    return __real_realloc(ptr, size);
+}
+
+/*
+ * make_words
+ * Compresses a WIDTH by HEIGHT image of gradients and noise into the words
+ * which the tests decode
+ */
+void make_words(US_TYPE *words)
+{
+    struct Pnm_rgb top[WIDTH], bottom[WIDTH];
+    uint32_t seed = 40;
+
+    for (int row = 0; row < HEIGHT / 2; row++) {
+        for (int col = 0; col < WIDTH; col++) {
+            struct Pnm_rgb *pixels[2] = { &top[col], &bottom[col] };
+            for (int i = 0; i < 2; i++) {
+                seed = seed * 1103515245 + 12345;
+                pixels[i]->red = (col + (seed >> 16)) % (DENOMINATOR + 1);
+                pixels[i]->green = (row * 2 + i) % (DENOMINATOR + 1);
+                pixels[i]->blue = (seed >> 8) % (DENOMINATOR + 1);
+            }
+        }
+        simd40_encode_row(top, bottom, WIDTH / 2, DENOMINATOR,
+                          &words[row * (WIDTH / 2)]);
+    }
+}
+
+/*
+ * test_cv_to_rgb
+ * Decodes every word into a pixmap through unpack, dct_to_cv and
+ * set_cv_to_rgb, one pixel at a time
+ */
+void test_cv_to_rgb(const US_TYPE *words)
+{
+    struct Pnm_ppm pixmap = {
+        .width = WIDTH,
+        .height = HEIGHT,
+        .denominator = DENOMINATOR,
+        .methods = uarray2_methods_plain,
+        .pixels = uarray2_methods_plain->new(WIDTH, HEIGHT,
+                                             sizeof(struct Pnm_rgb)),
+    };
+
+    allocations = 0;
+    for (int row = 0; row < HEIGHT / 2; row++) {
+        for (int col = 0; col < WIDTH / 2; col++) {
+            quant_dct qdct = unpack(words[row * (WIDTH / 2) + col]);
+            colorspace_block cv = dct_to_cv(dequantize(qdct));
+
+            set_cv_to_rgb(col * 2, row * 2, cv.tl, &pixmap);
+            set_cv_to_rgb(col * 2 + 1, row * 2, cv.tr, &pixmap);
+            set_cv_to_rgb(col * 2, row * 2 + 1, cv.ll, &pixmap);
+            set_cv_to_rgb(col * 2 + 1, row * 2 + 1, cv.lr, &pixmap);
+        }
+    }
+    check_allocations("cv_to_rgb");
+
+    uarray2_methods_plain->free(&pixmap.pixels);
+}
+
+/*
+ * test_decode_row
+ * Decodes every row of words into scanlines with the vectorized and the
+ * fixed-point decoders. Each is called once first, so that picking a
+ * kernel or building a table is not counted.
+ */
+void test_decode_row(const US_TYPE *words)
+{
+    unsigned char *top = malloc(WIDTH * 3);
+    unsigned char *bottom = malloc(WIDTH * 3);
+    assert(top != NULL && bottom != NULL);
+
+    simd40_decode_row(words, WIDTH / 2, top, bottom);
+    allocations = 0;
+    for (int row = 0; row < HEIGHT / 2; row++) {
+        simd40_decode_row(&words[row * (WIDTH / 2)], WIDTH / 2, top, bottom);
+    }
+    check_allocations("simd40_decode_row");
+
+    fixed40_decode_row(words, WIDTH / 2, top, bottom);
+    allocations = 0;
+    for (int row = 0; row < HEIGHT / 2; row++) {
+        fixed40_decode_row(&words[row * (WIDTH / 2)], WIDTH / 2, top, bottom);
+    }
+    check_allocations("fixed40_decode_row");
+
+    free(top);
+    free(bottom);
+}
+
+/*
+ * check_allocations
+ * Prints the result of a test, and exits with failure if anything was
+ * allocated since the count was reset
+ */
+void check_allocations(const char *what)
+{
+    if (allocations != 0) {
+        fprintf(stderr, "%s: %ld allocations decoding %d pixels\n", what,
+                allocations, WIDTH * HEIGHT);
+        exit(EXIT_FAILURE);
+    }
+    printf("%s: no allocations decoding %d pixels\n", what, WIDTH * HEIGHT);
+}
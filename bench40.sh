@@ -0,0 +1,57 @@
+#!/bin/sh
+#
+# bench40.sh
+# Purpose: Times 40image compressing and decompressing one image with -j 1
+#          up to -j MAX (the number of CPUs unless given), taking the best of
+#          RUNS runs of each, and prints the speedup over one thread.
+#          "make bench BENCH_IMAGE=image.ppm" runs it.
+#
+# Usage: bench40.sh image.ppm [max_threads]
+
+set -e
+
+IMAGE=$1
+MAX=${2:-$(nproc)}
+RUNS=${RUNS:-3}
+PROGRAM=${PROGRAM:-./40image}
+
+if [ -z "$IMAGE" ] || [ ! -r "$IMAGE" ]; then
+    echo "Usage: $0 image.ppm [max_threads]" >&2
+    exit 1
+fi
+
+COMPRESSED=$(mktemp)
+trap 'rm -f "$COMPRESSED"' EXIT
+"$PROGRAM" -c "$IMAGE" > "$COMPRESSED"
+
+# best wall-clock seconds of RUNS runs of the given command, output discarded
+best_time() {
+    best=""
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        start=$(date +%s.%N)
+        "$@" > /dev/null
+        end=$(date +%s.%N)
+        best=$(echo "$start $end $best" |
+               awk '{ t = $2 - $1; if ($3 == "" || t < $3) print t;
+                      else print $3 }')
+        i=$((i + 1))
+    done
+    echo "$best"
+}
+
+echo "$IMAGE, best of $RUNS runs, $(nproc) CPUs"
+echo "threads  compress  speedup  decompress  speedup"
+n=1
+while [ $n -le "$MAX" ]; do
+    c=$(best_time "$PROGRAM" -j $n -c "$IMAGE")
+    d=$(best_time "$PROGRAM" -j $n -d "$COMPRESSED")
+    if [ $n -eq 1 ]; then
+        c1=$c
+        d1=$d
+    fi
+    echo "$n $c $c1 $d $d1" |
+        awk '{ printf "%7d  %7.3fs  %6.2fx  %9.3fs  %6.2fx\n",
+               $1, $2, $3 / $2, $4, $5 / $4 }'
+    n=$((n + 1))
+done
@@ -7,6 +7,8 @@
  */
 
 #include "bitpack.h"
+#include "bitpack_n.h"
+#include "bitpack_unchecked.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -16,6 +18,21 @@
 #define S_TYPE int64_t
 #define US_TYPE uint64_t
 
+#define BULK_LANES 4            /* words handled per step by the _n functions */
+
+/* 
+ * the _n functions are also built for AVX2 on x86, and the best build is 
+ * picked when the program loads
+ */
+#if defined(__x86_64__) && !defined(__clang__)
+#define BULK_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define BULK_CLONES
+#endif
+
+typedef US_TYPE vword __attribute__((vector_size(BULK_LANES * sizeof(US_TYPE))));
+typedef S_TYPE vsword __attribute__((vector_size(BULK_LANES * sizeof(S_TYPE))));
+
 Except_T Bitpack_Overflow = { "Overflow packing bits" };
 
 /* shifting functions */
@@ -23,8 +40,9 @@ US_TYPE left_shift(US_TYPE initial, int shift_amount);
 US_TYPE right_shift(US_TYPE initial, int shift_amount);
 
 /* helper functions */
-S_TYPE convert_from_twocomp(S_TYPE value, int width);
 US_TYPE make_mask(int width, int lsb);
+static void replace_fields(US_TYPE *words, int count, unsigned width, 
+                           unsigned lsb, const US_TYPE *values);
 
 /* width test functions */
 
@@ -50,7 +68,8 @@ bool Bitpack_fitsu(US_TYPE n, unsigned width)
 /*
  * Bitpack_fitss
  * checks if a signed integer will fit into a word of width bits in 
- * two's complement 
+ * two's complement, so a width of 1 holds -1 and 0 (as Bitpack_gets and
+ * BitReader_gets read it back)
  * Inputs: a width of greater than 64 will result in a CRE 
  * Outputs: whether width bits can hold n
  */
@@ -60,11 +79,9 @@ bool Bitpack_fitss( S_TYPE n, unsigned width)
     
     if (width <= 0) {
         return false;
-    } else if (width < 2) {
-        return n == 0 || n == 1;
     } else {
-        int max_positive = (left_shift(2, width - 2)) - 1;
-        int max_negative = -1 * (left_shift(2, width - 2));
+        S_TYPE max_positive = (S_TYPE)(left_shift(1, width - 1) - 1);
+        S_TYPE max_negative = -max_positive - 1;
         return n <= max_positive && n >= max_negative;
     }
 }
@@ -91,8 +108,7 @@ US_TYPE Bitpack_getu(US_TYPE word, unsigned width, unsigned lsb)
         return 0;
     }
     
-    US_TYPE mask = make_mask(width, lsb);
-    return right_shift((word & mask), lsb);
+    return Bitpack_getu_unchecked(word, width, lsb);
 }
 
 /*
@@ -109,8 +125,14 @@ US_TYPE Bitpack_getu(US_TYPE word, unsigned width, unsigned lsb)
  */
 S_TYPE Bitpack_gets(US_TYPE word, unsigned width, unsigned lsb) 
 {
-    word = Bitpack_getu(word, width, lsb);
-    return convert_from_twocomp(word, width);
+    assert (width <= MAX_BITS);
+    assert (width + lsb <= MAX_BITS);
+    
+    if (width == 0) {
+        return 0;
+    }
+    
+    return Bitpack_gets_unchecked(word, width, lsb);
 }
 
 /* field update functions */
@@ -137,11 +159,7 @@ US_TYPE Bitpack_newu(US_TYPE word, unsigned width, unsigned lsb, US_TYPE value)
         RAISE(Bitpack_Overflow);
     }
     
-    US_TYPE mask = make_mask(width, lsb);
-    mask = ~mask;
-    word = word & mask;
-    value = left_shift(value, lsb);
-    return word | value;
+    return Bitpack_newu_unchecked(word, width, lsb, value);
 }
 
 /*
@@ -166,14 +184,178 @@ US_TYPE Bitpack_news(US_TYPE word, unsigned width, unsigned lsb, S_TYPE value)
         RAISE(Bitpack_Overflow);
     }
 
-    US_TYPE mask = make_mask(width, lsb);
-    mask = ~mask;
-    word = word & mask;
-    US_TYPE mask2 = make_mask(width, 0); 
-    value = value & mask2;
-    value = left_shift(value, lsb);
+    return Bitpack_news_unchecked(word, width, lsb, value);
+}
+
+/* bulk field functions */
+
+/*
+ * Bitpack_getu_n
+ * Extracts the unsigned field of width bits at lsb from each of count words,
+ * BULK_LANES words at a time with vector shifts and masks
+ * Inputs: array of count words (cannot be null unless count is 0), number of
+ *         words, unsigned ints representing width and lsb, array of count
+ *         fields to fill (cannot be null unless count is 0)
+ *         Width must be less than the number of maximum bits and width + lsb
+ *         must be less than the number of maximum bits
+ * Outputs: For valid inputs, void (fields holds the extracted values)
+ *         For invalid width and lsb values or null arrays, CRE and program 
+ *         exits
+ */
+BULK_CLONES
+void Bitpack_getu_n(const US_TYPE *words, int count, unsigned width, 
+                    unsigned lsb, US_TYPE *fields)
+{
+    assert(width <= MAX_BITS);
+    assert(width + lsb <= MAX_BITS);
+    assert((words != NULL && fields != NULL) || count == 0);
+    
+    if (count == 0) {
+        return;
+    }
+    if (width == 0) {
+        memset(fields, 0, count * sizeof(*fields));
+        return;
+    }
+    
+    US_TYPE mask = make_mask(width, 0);
+    int i = 0;
+    
+    for (; i + BULK_LANES <= count; i += BULK_LANES) {
+        vword word;
+        memcpy(&word, &words[i], sizeof(word));
+        word = (word >> lsb) & mask;
+        memcpy(&fields[i], &word, sizeof(word));
+    }
+    for (; i < count; i++) {
+        fields[i] = (words[i] >> lsb) & mask;
+    }
+}
+
+/*
+ * Bitpack_gets_n
+ * Extracts the signed field of width bits at lsb from each of count words,
+ * BULK_LANES words at a time. Fields are sign-extended by shifting them to
+ * the top of the word, then arithmetic shifting them back down.
+ * Inputs: array of count words (cannot be null unless count is 0), number of
+ *         words, unsigned ints representing width and lsb, array of count
+ *         fields to fill (cannot be null unless count is 0)
+ *         Width must be less than the number of maximum bits and width + lsb
+ *         must be less than the number of maximum bits
+ * Outputs: For valid inputs, void (fields holds the extracted values)
+ *         For invalid width and lsb values or null arrays, CRE and program 
+ *         exits
+ */
+BULK_CLONES
+void Bitpack_gets_n(const US_TYPE *words, int count, unsigned width, 
+                    unsigned lsb, S_TYPE *fields)
+{
+    assert(width <= MAX_BITS);
+    assert(width + lsb <= MAX_BITS);
+    assert((words != NULL && fields != NULL) || count == 0);
+    
+    if (count == 0) {
+        return;
+    }
+    if (width == 0) {
+        memset(fields, 0, count * sizeof(*fields));
+        return;
+    }
+    
+    unsigned up = MAX_BITS - lsb - width;
+    unsigned down = MAX_BITS - width;
+    int i = 0;
+    
+    for (; i + BULK_LANES <= count; i += BULK_LANES) {
+        vword word;
+        memcpy(&word, &words[i], sizeof(word));
+        vsword field = (vsword)(word << up) >> down;
+        memcpy(&fields[i], &field, sizeof(field));
+    }
+    for (; i < count; i++) {
+        fields[i] = (S_TYPE)(words[i] << up) >> down;
+    }
+}
+
+/*
+ * Bitpack_newu_n
+ * Replaces the field of width bits at lsb in each of count words with the
+ * matching unsigned value. All the values are ORed together and checked 
+ * once, before any word changes.
+ * Inputs: array of count words to update (cannot be null unless count is 0),
+ *         number of words, unsigned ints representing width and lsb, array
+ *         of count values (cannot be null unless count is 0)
+ *         Width must be less than the number of maximum bits and width + lsb
+ *         must be less than the number of maximum bits
+ * Outputs: For valid inputs, void (words holds the updated words)
+ *         If any value does not fit in width bits, Bitpack_Overflow is raised
+ *         For invalid width and lsb values or null arrays, CRE and program 
+ *         exits
+ */
+BULK_CLONES
+void Bitpack_newu_n(US_TYPE *words, int count, unsigned width, unsigned lsb,
+                    const US_TYPE *values)
+{
+    assert(width <= MAX_BITS);
+    assert(width + lsb <= MAX_BITS);
+    assert((words != NULL && values != NULL) || count == 0);
+    
+    if (count == 0) {
+        return;
+    }
+    
+    US_TYPE bits = 0;
+    for (int i = 0; i < count; i++) {
+        bits |= values[i];
+    }
+    if (!Bitpack_fitsu(bits, width)) { /* check if every value fits */
+        RAISE(Bitpack_Overflow);
+    }
+    
+    replace_fields(words, count, width, lsb, values);
+}
+
+/*
+ * Bitpack_news_n
+ * Replaces the field of width bits at lsb in each of count words with the
+ * matching signed value. The values are biased to be unsigned, ORed 
+ * together and checked once, before any word changes; as with 
+ * Bitpack_fitss, a field of width 1 holds -1 or 0.
+ * Inputs: array of count words to update (cannot be null unless count is 0),
+ *         number of words, unsigned ints representing width and lsb, array
+ *         of count values (cannot be null unless count is 0)
+ *         Width must be less than the number of maximum bits and width + lsb
+ *         must be less than the number of maximum bits
+ * Outputs: For valid inputs, void (words holds the updated words)
+ *         If any value does not fit in width bits, Bitpack_Overflow is raised
+ *         For invalid width and lsb values or null arrays, CRE and program 
+ *         exits
+ */
+BULK_CLONES
+void Bitpack_news_n(US_TYPE *words, int count, unsigned width, unsigned lsb,
+                    const S_TYPE *values)
+{
+    assert(width <= MAX_BITS);
+    assert(width + lsb <= MAX_BITS);
+    assert((words != NULL && values != NULL) || count == 0);
+    
+    if (count == 0) {
+        return;
+    }
+    if (width == 0) {
+        RAISE(Bitpack_Overflow);
+    }
+    
+    US_TYPE bias = left_shift(1, width - 1);
+    US_TYPE bits = 0;
+    for (int i = 0; i < count; i++) {
+        bits |= (US_TYPE)values[i] + bias;
+    }
+    if (!Bitpack_fitsu(bits, width)) { /* check if every value fits */
+        RAISE(Bitpack_Overflow);
+    }
     
-    return word | value;
+    replace_fields(words, count, width, lsb, (const US_TYPE *)values);
 }
 
 /* shifting functions */
@@ -218,22 +400,29 @@ US_TYPE make_mask(int width, int lsb)
 }
 
 /*
- * convert_from_twocomp
- * Takes a value and converts from its two's complement representation if it
- * is a negative signed value
- * Inputs: unsigned value on which to perform conversion, unsigned integer 
- *         representing width of field
- * Outputs: For valid inputs, returns the converted signed value
- *          
+ * replace_fields
+ * Replaces the field of width bits at lsb in each of count words with the
+ * low width bits of the matching value, BULK_LANES words at a time
+ * Inputs: array of count words to update, number of words, unsigned ints 
+ *         representing width (at least 1) and lsb, array of count values
+ * Outputs: void (words holds the updated words)
  */
-S_TYPE convert_from_twocomp(S_TYPE value, int width) {
-    bool is_negative = (value & left_shift(1, width - 1)) != 0;
-    if (is_negative) {
-        US_TYPE mask = ~0;
-        mask = right_shift(mask, MAX_BITS - width);;
-        value = (~value) & mask;
-        return -1 * (value + 1);
-    } else { /* no conversion needed */
-        return value;
+BULK_CLONES
+static void replace_fields(US_TYPE *words, int count, unsigned width, 
+                           unsigned lsb, const US_TYPE *values)
+{
+    US_TYPE value_mask = make_mask(width, 0);
+    US_TYPE keep_mask = ~make_mask(width, lsb);
+    int i = 0;
+    
+    for (; i + BULK_LANES <= count; i += BULK_LANES) {
+        vword word, value;
+        memcpy(&word, &words[i], sizeof(word));
+        memcpy(&value, &values[i], sizeof(value));
+        word = (word & keep_mask) | ((value & value_mask) << lsb);
+        memcpy(&words[i], &word, sizeof(word));
+    }
+    for (; i < count; i++) {
+        words[i] = (words[i] & keep_mask) | ((values[i] & value_mask) << lsb);
     }
 }
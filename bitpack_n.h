@@ -0,0 +1,49 @@
+/*
+ * bitpack_n.h
+ * Purpose: Interface to bulk versions of the Bitpack field functions, which
+ *          apply the same (width, lsb) field operation to a whole array of 
+ *          64 bit words using vector shifts and masks
+ */
+#ifndef BITPACK_N_INCLUDED
+#define BITPACK_N_INCLUDED
+
+#include <stdint.h>
+#include "bitpack.h"
+
+/*
+ * Bitpack_getu_n
+ * Extracts the unsigned field of width bits at lsb from each of count words
+ * into fields, as Bitpack_getu does for one word
+ */
+void Bitpack_getu_n(const uint64_t *words, int count, unsigned width, 
+                    unsigned lsb, uint64_t *fields);
+
+/*
+ * Bitpack_gets_n
+ * Extracts the signed field of width bits at lsb from each of count words
+ * into fields, as Bitpack_gets does for one word
+ */
+void Bitpack_gets_n(const uint64_t *words, int count, unsigned width, 
+                    unsigned lsb, int64_t *fields);
+
+/*
+ * Bitpack_newu_n
+ * Replaces the field of width bits at lsb in each of count words with the
+ * matching unsigned value, as Bitpack_newu does for one word. Every value is
+ * checked before any word changes, and Bitpack_Overflow is raised once if
+ * any value does not fit.
+ */
+void Bitpack_newu_n(uint64_t *words, int count, unsigned width, unsigned lsb,
+                    const uint64_t *values);
+
+/*
+ * Bitpack_news_n
+ * Replaces the field of width bits at lsb in each of count words with the
+ * matching signed value, as Bitpack_news does for one word. Every value is
+ * checked before any word changes, and Bitpack_Overflow is raised once if
+ * any value does not fit.
+ */
+void Bitpack_news_n(uint64_t *words, int count, unsigned width, unsigned lsb,
+                    const int64_t *values);
+
+#endif
@@ -0,0 +1,76 @@
+/*
+ * bitpack_unchecked.h
+ * Purpose: Header-only versions of the Bitpack field functions for callers
+ *          whose widths, lsbs and values are already known to be valid. 
+ *          They do no asserts or overflow checks and never raise, so with 
+ *          constant widths and lsbs each one inlines to a shift and a mask.
+ *          The checked functions of bitpack.h remain for untrusted input.
+ */
+#ifndef BITPACK_UNCHECKED_INCLUDED
+#define BITPACK_UNCHECKED_INCLUDED
+
+#include <stdint.h>
+
+#define BITPACK_MAX_BITS 64
+
+/*
+ * Bitpack_mask_unchecked
+ * Returns a mask of width one bits starting at lsb
+ * Inputs: 1 <= width and width + lsb <= 64 (not checked)
+ */
+static inline uint64_t Bitpack_mask_unchecked(unsigned width, unsigned lsb)
+{
+    return (~(uint64_t)0 >> (BITPACK_MAX_BITS - width)) << lsb;
+}
+
+/*
+ * Bitpack_getu_unchecked
+ * Extracts the unsigned field of width bits at lsb from word
+ * Inputs: 1 <= width and width + lsb <= 64 (not checked)
+ */
+static inline uint64_t Bitpack_getu_unchecked(uint64_t word, unsigned width, 
+                                              unsigned lsb)
+{
+    return (word & Bitpack_mask_unchecked(width, lsb)) >> lsb;
+}
+
+/*
+ * Bitpack_gets_unchecked
+ * Extracts the signed field of width bits at lsb from word, sign-extending
+ * it by shifting it to the top of the word and arithmetic shifting it back
+ * Inputs: 1 <= width and width + lsb <= 64 (not checked)
+ */
+static inline int64_t Bitpack_gets_unchecked(uint64_t word, unsigned width, 
+                                             unsigned lsb)
+{
+    return (int64_t)(word << (BITPACK_MAX_BITS - lsb - width)) >> 
+           (BITPACK_MAX_BITS - width);
+}
+
+/*
+ * Bitpack_newu_unchecked
+ * Returns word with the field of width bits at lsb replaced by value
+ * Inputs: 1 <= width, width + lsb <= 64 and value fits in width unsigned 
+ *         bits (not checked; extra bits of value are dropped)
+ */
+static inline uint64_t Bitpack_newu_unchecked(uint64_t word, unsigned width,
+                                              unsigned lsb, uint64_t value)
+{
+    uint64_t mask = Bitpack_mask_unchecked(width, lsb);
+    return (word & ~mask) | ((value << lsb) & mask);
+}
+
+/*
+ * Bitpack_news_unchecked
+ * Returns word with the field of width bits at lsb replaced by the two's
+ * complement representation of value
+ * Inputs: 1 <= width, width + lsb <= 64 and value fits in width signed bits
+ *         (not checked; extra bits of value are dropped)
+ */
+static inline uint64_t Bitpack_news_unchecked(uint64_t word, unsigned width,
+                                              unsigned lsb, int64_t value)
+{
+    return Bitpack_newu_unchecked(word, width, lsb, (uint64_t)value);
+}
+
+#endif
@@ -0,0 +1,189 @@
+/*
+ * bitstream.c
+ * Purpose: Write and read streams of variable-width bit fields through a
+ *          large byte buffer, which is handed to (or taken from) the OS with
+ *          one fwrite or fread at a time. The puts and gets themselves are
+ *          inline in bitstream.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "assert.h"
+#include "bitstream.h"
+
+/*
+ * BitWriter_new
+ * Creates a writer with an empty stream which writes to fp
+ * Input: File stream pointer (cannot be null)
+ * Output: For valid inputs, the new writer
+ *         For invalid inputs (null file, out of memory), CRE and program exits
+ */
+BitWriter_T BitWriter_new(FILE *fp)
+{
+    assert(fp != NULL);
+
+    BitWriter_T writer = malloc(sizeof(*writer));
+    assert(writer != NULL);
+
+    writer->fp = fp;
+    writer->acc = 0;
+    writer->count = 0;
+    writer->pos = 0;
+    return writer;
+}
+
+/*
+ * BitWriter_free
+ * Frees a writer and sets it to null. Bits which were not flushed are lost.
+ * Input: pointer to the writer (neither can be null)
+ * Output: For valid inputs, void
+ *         For invalid inputs (null pointers), CRE and program exits
+ */
+void BitWriter_free(BitWriter_T *writer)
+{
+    assert(writer != NULL && *writer != NULL);
+
+    free(*writer);
+    *writer = NULL;
+}
+
+/*
+ * BitWriter_flush
+ * Pads the pending bits with zeros up to a whole byte and writes them, with
+ * every other buffered byte, to the file
+ * Input: the writer (cannot be null)
+ * Output: For valid inputs, void (the whole stream so far is in the file)
+ *         For invalid inputs (null writer, failed write), CRE and program
+ *         exits
+ */
+void BitWriter_flush(BitWriter_T writer)
+{
+    assert(writer != NULL);
+
+    if (writer->count > 0) {
+        Bitstream_store(&writer->buf[writer->pos], writer->acc);
+        writer->pos++;
+        writer->acc = 0;
+        writer->count = 0;
+    }
+    BitWriter_drain(writer);
+
+    int status = fflush(writer->fp);
+    assert(status == 0);
+}
+
+/*
+ * BitWriter_drain
+ * Writes every whole byte in the buffer to the file with a single fwrite.
+ * The pending bits stay in the accumulator.
+ * Input: the writer (cannot be null)
+ * Output: For valid inputs, void (the buffer is empty)
+ *         For invalid inputs (null writer, failed write), CRE and program
+ *         exits
+ */
+void BitWriter_drain(BitWriter_T writer)
+{
+    assert(writer != NULL);
+
+    size_t written = fwrite(writer->buf, 1, writer->pos, writer->fp);
+    assert(written == writer->pos);
+    writer->pos = 0;
+}
+
+/*
+ * BitReader_new
+ * Creates a reader for the stream in fp. Nothing is read until the first
+ * get.
+ * Input: File stream pointer (cannot be null)
+ * Output: For valid inputs, the new reader
+ *         For invalid inputs (null file, out of memory), CRE and program exits
+ */
+BitReader_T BitReader_new(FILE *fp)
+{
+    assert(fp != NULL);
+
+    BitReader_T reader = malloc(sizeof(*reader));
+    assert(reader != NULL);
+
+    reader->fp = fp;
+    reader->pos = 0;
+    reader->limit = 0;
+    reader->total = 0;
+    memset(reader->buf, 0, BITSTREAM_SLACK);
+    return reader;
+}
+
+/*
+ * BitReader_free
+ * Frees a reader and sets it to null
+ * Input: pointer to the reader (neither can be null)
+ * Output: For valid inputs, void
+ *         For invalid inputs (null pointers), CRE and program exits
+ */
+void BitReader_free(BitReader_T *reader)
+{
+    assert(reader != NULL && *reader != NULL);
+
+    free(*reader);
+    *reader = NULL;
+}
+
+/*
+ * BitReader_align
+ * Skips the bits left in the current byte
+ * Input: the reader (cannot be null)
+ * Output: For valid inputs, void (the next get starts on a byte boundary)
+ *         For invalid inputs (null reader), CRE and program exits
+ */
+void BitReader_align(BitReader_T reader)
+{
+    assert(reader != NULL);
+
+    reader->pos = (reader->pos + 7) & ~(size_t)7;
+}
+
+/*
+ * BitReader_bits_read
+ * Returns the number of bits read from the stream so far
+ * Input: the reader (cannot be null)
+ * Output: For valid inputs, the number of bits
+ *         For invalid inputs (null reader), CRE and program exits
+ */
+size_t BitReader_bits_read(BitReader_T reader)
+{
+    assert(reader != NULL);
+
+    return reader->total + reader->pos;
+}
+
+/*
+ * BitReader_refill
+ * Moves the bytes not yet read to the front of the buffer and fills the rest
+ * of it with a single fread. The bytes after the data are zeroed, so the
+ * 8-byte loads of the gets never see stale bytes.
+ * Input: the reader (cannot be null), width of the field about to be read
+ * Output: For valid inputs, void (at least width bits are ready at pos)
+ *         For invalid inputs (null reader, stream too short), CRE and
+ *         program exits
+ */
+void BitReader_refill(BitReader_T reader, unsigned width)
+{
+    assert(reader != NULL);
+
+    size_t first = reader->pos >> 3;
+    size_t filled = reader->limit >> 3;
+    size_t kept = filled - first;
+
+    memmove(reader->buf, &reader->buf[first], kept);
+    reader->total += first * 8;
+    reader->pos -= first * 8;
+
+    filled = kept + fread(&reader->buf[kept], 1, BITSTREAM_BUFFER - kept,
+                          reader->fp);
+    memset(&reader->buf[filled], 0, BITSTREAM_SLACK);
+    reader->limit = filled * 8;
+
+    /* check if supplied stream is too short */
+    assert(reader->pos + width <= reader->limit);
+}
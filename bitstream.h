@@ -0,0 +1,216 @@
+/*
+ * bitstream.h
+ * Purpose: Interface to write and read streams of variable-width bit fields
+ *          which may cross word boundaries, as a companion to the Bitpack
+ *          functions, which only pack fields into a single word. Fields are
+ *          stored most significant bit first, so 32-bit fields give the same
+ *          bytes as words40_write.
+ */
+#ifndef BITSTREAM_INCLUDED
+#define BITSTREAM_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+#include "assert.h"
+#include "except.h"
+#include "bitpack.h"
+
+/* widest field which can be written or read in one call */
+#define BITSTREAM_MAX_WIDTH 57
+
+/* bytes gathered before they are handed to (or taken from) the OS */
+#define BITSTREAM_BUFFER 65536
+
+/* bytes past the end of the buffer touched by the 8-byte loads and stores */
+#define BITSTREAM_SLACK 8
+
+/*
+ * Writer state: the bits not yet stored sit at the top of acc, and each put
+ * stores all 8 bytes of acc at pos, then advances pos past the whole bytes
+ */
+typedef struct BitWriter_T {
+    FILE *fp;
+    uint64_t acc;           /* pending bits, left aligned */
+    unsigned count;         /* pending bits, at most 7 between puts */
+    size_t pos;             /* bytes of buf in use */
+    unsigned char buf[BITSTREAM_BUFFER + BITSTREAM_SLACK];
+} *BitWriter_T;
+
+/*
+ * Reader state: pos is the index of the next bit in buf, and every get loads
+ * the 8 bytes holding it, so no accumulator has to be refilled bit by bit
+ */
+typedef struct BitReader_T {
+    FILE *fp;
+    size_t pos;             /* next bit to read */
+    size_t limit;           /* number of bits of data in buf */
+    size_t total;           /* bits read before the start of buf */
+    unsigned char buf[BITSTREAM_BUFFER + BITSTREAM_SLACK];
+} *BitReader_T;
+
+/*
+ * BitWriter_new, BitWriter_free
+ * Create a writer which writes to fp, and free it. The writer must be
+ * flushed before it is freed, or the buffered bits are lost.
+ */
+BitWriter_T BitWriter_new(FILE *fp);
+void BitWriter_free(BitWriter_T *writer);
+
+/*
+ * BitWriter_flush
+ * Pads the stream with zero bits up to a whole byte and writes every
+ * buffered byte to the file
+ */
+void BitWriter_flush(BitWriter_T writer);
+
+/* writes the full buffer to the file; called by the puts */
+void BitWriter_drain(BitWriter_T writer);
+
+/*
+ * BitReader_new, BitReader_free
+ * Create a reader which reads from fp, and free it. Since the reader reads
+ * ahead, bytes after the stream are consumed from fp too.
+ */
+BitReader_T BitReader_new(FILE *fp);
+void BitReader_free(BitReader_T *reader);
+
+/*
+ * BitReader_align
+ * Skips the bits left in the current byte, so that the next get starts on a
+ * byte boundary
+ */
+void BitReader_align(BitReader_T reader);
+
+/*
+ * BitReader_bits_read
+ * Returns the number of bits read from the stream so far
+ */
+size_t BitReader_bits_read(BitReader_T reader);
+
+/* moves the unread bytes to the front of the buffer and reads more of them */
+void BitReader_refill(BitReader_T reader, unsigned width);
+
+/*
+ * Bitstream_store, Bitstream_load
+ * Store and load 8 bytes in big-endian order at any address
+ */
+static inline void Bitstream_store(unsigned char *p, uint64_t word)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    __builtin_memcpy(p, &word, sizeof(word));
+}
+
+static inline uint64_t Bitstream_load(const unsigned char *p)
+{
+    uint64_t word;
+    __builtin_memcpy(&word, p, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+/*
+ * BitWriter_putu
+ * Appends the low width bits of value to the stream. The pending bits and
+ * the new field are stored with one 8-byte store, and the whole bytes are
+ * then dropped from the accumulator, so the only branch is the one taken
+ * when the buffer is full.
+ * Input: the writer (cannot be null), value, 1 <= width <= 57
+ * Output: For valid inputs, void (the field is added to the stream)
+ *         For a bad width, CRE and program exits
+ *         If value does not fit in width unsigned bits, raises
+ *         Bitpack_Overflow
+ */
+static inline void BitWriter_putu(BitWriter_T writer, uint64_t value,
+                                  unsigned width)
+{
+    assert(writer != NULL);
+    assert(width >= 1 && width <= BITSTREAM_MAX_WIDTH);
+    if ((value >> width) != 0) {
+        RAISE(Bitpack_Overflow);
+    }
+
+    unsigned count = writer->count + width;
+    uint64_t acc = writer->acc | (value << (64 - count));
+
+    Bitstream_store(&writer->buf[writer->pos], acc);
+    writer->pos += count >> 3;
+
+    /* keep the partial byte; count may be 64, which a shift cannot clear */
+    writer->acc = (acc << ((count & ~7u) & 63)) &
+                  ~(~(uint64_t)0 >> (count & 7));
+    writer->count = count & 7;
+
+    if (writer->pos >= BITSTREAM_BUFFER) {
+        BitWriter_drain(writer);
+    }
+}
+
+/*
+ * BitWriter_puts
+ * Appends value to the stream as a width bit two's complement field. The
+ * values which fit are those Bitpack_fitss accepts, so a width of 1 holds
+ * -1 and 0.
+ * Input: the writer (cannot be null), value, 1 <= width <= 57
+ * Output: For valid inputs, void (the field is added to the stream)
+ *         For a bad width, CRE and program exits
+ *         If value does not fit in width signed bits, raises
+ *         Bitpack_Overflow
+ */
+static inline void BitWriter_puts(BitWriter_T writer, int64_t value,
+                                  unsigned width)
+{
+    assert(width >= 1 && width <= BITSTREAM_MAX_WIDTH);
+    uint64_t biased = (uint64_t)value + ((uint64_t)1 << (width - 1));
+    if ((biased >> width) != 0) {
+        RAISE(Bitpack_Overflow);
+    }
+
+    BitWriter_putu(writer, (uint64_t)value & (~(uint64_t)0 >> (64 - width)),
+                   width);
+}
+
+/*
+ * BitReader_getu
+ * Reads the next width bits of the stream as an unsigned value. The 8 bytes
+ * holding the next bit are loaded at once and shifted into place, which
+ * always leaves at least 57 valid bits.
+ * Input: the reader (cannot be null), 1 <= width <= 57
+ * Output: For valid inputs, the value of the field
+ *         For a bad width or a stream with fewer than width bits left, CRE
+ *         and program exits
+ */
+static inline uint64_t BitReader_getu(BitReader_T reader, unsigned width)
+{
+    assert(reader != NULL);
+    assert(width >= 1 && width <= BITSTREAM_MAX_WIDTH);
+
+    if (reader->pos + width > reader->limit) {
+        BitReader_refill(reader, width);
+    }
+
+    size_t pos = reader->pos;
+    uint64_t word = Bitstream_load(&reader->buf[pos >> 3]) << (pos & 7);
+
+    reader->pos = pos + width;
+    return word >> (64 - width);
+}
+
+/*
+ * BitReader_gets
+ * Reads the next width bits of the stream as a two's complement value
+ * Input: the reader (cannot be null), 1 <= width <= 57
+ * Output: For valid inputs, the value of the field
+ *         For a bad width or a stream with fewer than width bits left, CRE
+ *         and program exits
+ */
+static inline int64_t BitReader_gets(BitReader_T reader, unsigned width)
+{
+    return (int64_t)(BitReader_getu(reader, width) << (64 - width)) >>
+           (64 - width);
+}
+
+#endif
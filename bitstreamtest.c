@@ -0,0 +1,264 @@
+/*
+ * bitstreamtest.c
+ * Purpose: Round-trip tests for the BitWriter and BitReader of bitstream.h.
+ *          Fields are written to a temporary file, read back and compared,
+ *          in patterns chosen to reach the paths that only run at buffer
+ *          boundaries.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "assert.h"
+#include "except.h"
+#include "bitpack.h"
+#include "bitstream.h"
+
+#define RANDOM_FIELDS 300000    /* about 1MB, many times BITSTREAM_BUFFER */
+#define PAIRS 20000
+
+/* a field to write and expect back */
+typedef struct field {
+    unsigned width;
+    bool is_signed;
+    uint64_t value;             /* the int64_t value for signed fields */
+}field;
+
+void test_random();
+void test_57_at_offset_7();
+void test_boundary();
+void test_signed_range();
+void test_short_stream();
+void round_trip(const char *name, const field *fields, int count);
+uint64_t random_word();
+
+int main()
+{
+    printf("Testing random fields ...\n");
+    test_random();
+    printf("Testing 57-bit fields at bit offset 7 ...\n");
+    test_57_at_offset_7();
+    printf("Testing buffer boundaries ...\n");
+    test_boundary();
+    printf("Testing signed ranges ...\n");
+    test_signed_range();
+    printf("Testing short streams ...\n");
+    test_short_stream();
+    exit(EXIT_SUCCESS);
+}
+
+/*
+ * test_random
+ * Fields of random widths from 1 to 57, signed and unsigned, with values
+ * anywhere in their range and often at its ends
+ */
+void test_random()
+{
+    field *fields = malloc(RANDOM_FIELDS * sizeof(*fields));
+    assert(fields != NULL);
+
+    for (int i = 0; i < RANDOM_FIELDS; i++) {
+        unsigned width = rand() % BITSTREAM_MAX_WIDTH + 1;
+        uint64_t mask = ~(uint64_t)0 >> (64 - width);
+        uint64_t value = random_word() & mask;
+
+        if (rand() % 8 == 0) {
+            value = rand() % 2 ? mask : 0;
+        }
+        fields[i].width = width;
+        fields[i].is_signed = rand() % 2;
+        fields[i].value = value;
+        if (fields[i].is_signed) {
+            /* sign extend, so the value is in the signed range */
+            fields[i].value = (int64_t)(value << (64 - width)) >>
+                              (64 - width);
+        }
+    }
+    round_trip("random", fields, RANDOM_FIELDS);
+    free(fields);
+}
+
+/*
+ * test_57_at_offset_7
+ * Pairs of a 7-bit and a 57-bit field, so every 57-bit put starts at bit 7
+ * of a byte and leaves exactly 64 pending bits, which the writer must clear
+ * without a 64-bit shift
+ */
+void test_57_at_offset_7()
+{
+    field *fields = malloc(2 * PAIRS * sizeof(*fields));
+    assert(fields != NULL);
+
+    for (int i = 0; i < PAIRS; i++) {
+        fields[2 * i] = (field){ 7, false, random_word() & 0x7f };
+        fields[2 * i + 1] = (field){ 57, i % 2 == 1,
+                                     random_word() >> (64 - 57) };
+        if (i % 2 == 1) {
+            fields[2 * i + 1].value = (int64_t)(fields[2 * i + 1].value
+                                                << 7) >> 7;
+        }
+    }
+    round_trip("57 at offset 7", fields, 2 * PAIRS);
+    free(fields);
+}
+
+/*
+ * test_boundary
+ * Exactly BITSTREAM_BUFFER bytes of 8-bit fields, so the writer drains
+ * when the buffer is exactly full, then a 3-bit field and another buffer of
+ * 8-bit fields, so the reader refills while the field it needs starts part
+ * way through a byte
+ */
+void test_boundary()
+{
+    int count = 2 * BITSTREAM_BUFFER + 2;
+    field *fields = malloc(count * sizeof(*fields));
+    assert(fields != NULL);
+
+    int i = 0;
+    for (int k = 0; k < BITSTREAM_BUFFER; k++) {
+        fields[i++] = (field){ 8, false, random_word() & 0xff };
+    }
+    fields[i++] = (field){ 3, false, 5 };
+    for (int k = 0; k < BITSTREAM_BUFFER; k++) {
+        fields[i++] = (field){ 8, true, (int64_t)(int8_t)random_word() };
+    }
+    fields[i++] = (field){ 57, false, random_word() >> (64 - 57) };
+    round_trip("boundary", fields, count);
+    free(fields);
+}
+
+/*
+ * test_signed_range
+ * For every width, BitWriter_puts must accept exactly the values which
+ * Bitpack_fitss accepts, so a width of 1 holds -1 and 0
+ */
+void test_signed_range()
+{
+    FILE *fp = tmpfile();
+    assert(fp != NULL);
+    BitWriter_T writer = BitWriter_new(fp);
+    int failures = 0;
+
+    for (unsigned width = 1; width <= BITSTREAM_MAX_WIDTH; width++) {
+        int64_t half = (int64_t)1 << (width - 1);
+        int64_t values[6] = { -half - 1, -half, -1, 0, half - 1, half };
+
+        for (int i = 0; i < 6; i++) {
+            volatile bool raised = false;
+            TRY
+                BitWriter_puts(writer, values[i], width);
+            EXCEPT(Bitpack_Overflow)
+                raised = true;
+            END_TRY;
+            if (raised == Bitpack_fitss(values[i], width)) {
+                printf("puts: %ld in %u bits %s\n", (long)values[i], width,
+                       raised ? "raised" : "did not raise");
+                failures++;
+            }
+        }
+    }
+
+    BitWriter_free(&writer);
+    fclose(fp);
+    if (failures > 0) {
+        exit(EXIT_FAILURE);
+    }
+    printf("signed ranges: puts agrees with Bitpack_fitss\n");
+}
+
+/*
+ * test_short_stream
+ * A stream of 13 bytes holds 104 bits; reading them all works, and reading
+ * any more fails
+ */
+void test_short_stream()
+{
+    FILE *fp = tmpfile();
+    assert(fp != NULL);
+
+    BitWriter_T writer = BitWriter_new(fp);
+    BitWriter_putu(writer, 0x1234567, 50);
+    BitWriter_putu(writer, 0x7654321, 50);
+    BitWriter_flush(writer);
+    BitWriter_free(&writer);
+    rewind(fp);
+
+    BitReader_T reader = BitReader_new(fp);
+    bool ok = BitReader_getu(reader, 50) == 0x1234567 &&
+              BitReader_getu(reader, 50) == 0x7654321 &&
+              BitReader_getu(reader, 4) == 0;
+
+    volatile bool failed = false;
+    TRY
+        BitReader_getu(reader, 1);
+    EXCEPT(Assert_Failed)
+        failed = true;
+    END_TRY;
+
+    BitReader_free(&reader);
+    fclose(fp);
+    if (!ok || !failed) {
+        printf("short stream: %s\n", !ok ? "bad values"
+                                         : "read past the end");
+        exit(EXIT_FAILURE);
+    }
+    printf("short stream: reading past the end fails\n");
+}
+
+/*
+ * round_trip
+ * Writes count fields to a temporary file, reads them back, and exits with
+ * failure if any differs or the reader does not end where the writer did
+ */
+void round_trip(const char *name, const field *fields, int count)
+{
+    FILE *fp = tmpfile();
+    assert(fp != NULL);
+    size_t bits = 0;
+
+    BitWriter_T writer = BitWriter_new(fp);
+    for (int i = 0; i < count; i++) {
+        if (fields[i].is_signed) {
+            BitWriter_puts(writer, (int64_t)fields[i].value,
+                           fields[i].width);
+        } else {
+            BitWriter_putu(writer, fields[i].value, fields[i].width);
+        }
+        bits += fields[i].width;
+    }
+    BitWriter_flush(writer);
+    BitWriter_free(&writer);
+
+    long bytes = ftell(fp);
+    rewind(fp);
+
+    int failures = 0;
+    BitReader_T reader = BitReader_new(fp);
+    for (int i = 0; i < count; i++) {
+        uint64_t value = fields[i].is_signed
+                       ? (uint64_t)BitReader_gets(reader, fields[i].width)
+                       : BitReader_getu(reader, fields[i].width);
+        if (value != fields[i].value && failures++ < 10) {
+            printf("%s: field %d of width %u\n", name, i, fields[i].width);
+        }
+    }
+    if (BitReader_bits_read(reader) != bits ||
+        (size_t)bytes != (bits + 7) / 8) {
+        printf("%s: %zu bits in %ld bytes\n", name, bits, bytes);
+        failures++;
+    }
+    BitReader_free(&reader);
+    fclose(fp);
+
+    if (failures > 0) {
+        exit(EXIT_FAILURE);
+    }
+    printf("%s: %d fields match\n", name, count);
+}
+
+uint64_t random_word()
+{
+    return ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ rand();
+}
@@ -0,0 +1,190 @@
+/*
+ * bulktest.c
+ * Purpose: Checks the bulk Bitpack functions of bitpack_n.h against the
+ *          scalar ones on random words, widths, lsbs and counts
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "assert.h"
+#include "except.h"
+#include "bitpack.h"
+#include "bitpack_n.h"
+
+#define BULK_TRIALS 100000
+#define BULK_MAX_COUNT 37       /* covers whole vectors and every tail */
+
+uint64_t random_word();
+uint64_t random_value(unsigned width);
+int64_t random_signed(unsigned width);
+void test_bulk();
+
+int main()
+{
+    printf("Testing bulk ...\n");
+    test_bulk();
+    exit(EXIT_SUCCESS);
+}
+
+uint64_t random_word()
+{
+    return ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ rand();
+}
+
+/*
+ * random_value
+ * Returns a value which fits in width bits, or one bit too wide one time in
+ * eight
+ */
+uint64_t random_value(unsigned width)
+{
+    uint64_t mask = width == 64 ? ~(uint64_t)0 : ((uint64_t)1 << width) - 1;
+    uint64_t value = random_word() & mask;
+    if (rand() % 8 == 0 && width < 64) {
+        value |= (uint64_t)1 << width;
+    }
+    return value;
+}
+
+/* random_signed: a value around the signed range of width bits */
+int64_t random_signed(unsigned width)
+{
+    if (width == 0) {
+        return rand() % 3 - 1;
+    }
+    if (width == 64) {
+        return (int64_t)random_word();
+    }
+    int64_t half = (int64_t)1 << (width - 1);
+    switch (rand() % 8) {
+    case 0:
+        return half;
+    case 1:
+        return -half - 1;
+    case 2:
+        return rand() % 2 ? half - 1 : -half;
+    default:
+        return (int64_t)(random_word() % (2 * (uint64_t)half)) - half;
+    }
+}
+
+bool scalar_newu(uint64_t *words, int count, unsigned width, unsigned lsb,
+                 const uint64_t *values)
+{
+    volatile bool raised = false;
+    for (int i = 0; i < count && !raised; i++) {
+        TRY
+            words[i] = Bitpack_newu(words[i], width, lsb, values[i]);
+        EXCEPT(Bitpack_Overflow)
+            raised = true;
+        END_TRY;
+    }
+    return raised;
+}
+
+bool scalar_news(uint64_t *words, int count, unsigned width, unsigned lsb,
+                 const int64_t *values)
+{
+    volatile bool raised = false;
+    for (int i = 0; i < count && !raised; i++) {
+        TRY
+            words[i] = Bitpack_news(words[i], width, lsb, values[i]);
+        EXCEPT(Bitpack_Overflow)
+            raised = true;
+        END_TRY;
+    }
+    return raised;
+}
+
+bool bulk_newu(uint64_t *words, int count, unsigned width, unsigned lsb,
+               const uint64_t *values)
+{
+    volatile bool raised = false;
+    TRY
+        Bitpack_newu_n(words, count, width, lsb, values);
+    EXCEPT(Bitpack_Overflow)
+        raised = true;
+    END_TRY;
+    return raised;
+}
+
+bool bulk_news(uint64_t *words, int count, unsigned width, unsigned lsb,
+               const int64_t *values)
+{
+    volatile bool raised = false;
+    TRY
+        Bitpack_news_n(words, count, width, lsb, values);
+    EXCEPT(Bitpack_Overflow)
+        raised = true;
+    END_TRY;
+    return raised;
+}
+
+/*
+ * test_bulk
+ * Checks the _n functions against the scalar ones on random words, widths,
+ * lsbs and counts. Widths 0, 1 and 64 come up more often than the rest.
+ * When a value does not fit, the bulk update must raise Bitpack_Overflow 
+ * and leave every word as it was.
+ */
+void test_bulk()
+{
+    uint64_t words[BULK_MAX_COUNT], expected[BULK_MAX_COUNT];
+    uint64_t bulk[BULK_MAX_COUNT], fields[BULK_MAX_COUNT];
+    uint64_t values[BULK_MAX_COUNT];
+    int64_t svalues[BULK_MAX_COUNT], sfields[BULK_MAX_COUNT];
+    int failures = 0;
+
+    for (int trial = 0; trial < BULK_TRIALS; trial++) {
+        unsigned widths[4] = { 0, 1, 64, rand() % 65 };
+        unsigned width = widths[rand() % 8 < 5 ? 3 : rand() % 3];
+        unsigned lsb = rand() % (65 - width);
+        int count = rand() % (BULK_MAX_COUNT + 1);
+
+        for (int i = 0; i < count; i++) {
+            words[i] = random_word();
+            values[i] = random_value(width);
+            svalues[i] = random_signed(width);
+        }
+
+        Bitpack_getu_n(words, count, width, lsb, fields);
+        Bitpack_gets_n(words, count, width, lsb, sfields);
+        for (int i = 0; i < count; i++) {
+            if (fields[i] != Bitpack_getu(words[i], width, lsb) ||
+                sfields[i] != Bitpack_gets(words[i], width, lsb)) {
+                printf("get: width %u lsb %u word %d of %d\n", width, lsb, 
+                       i, count);
+                failures++;
+            }
+        }
+
+        memcpy(expected, words, sizeof(words));
+        memcpy(bulk, words, sizeof(words));
+        bool should_raise = scalar_newu(expected, count, width, lsb, values);
+        bool raised = bulk_newu(bulk, count, width, lsb, values);
+        if (raised != should_raise || memcmp(bulk, should_raise ? words 
+                                             : expected, 
+                                             count * sizeof(*bulk)) != 0) {
+            printf("newu: width %u lsb %u count %d\n", width, lsb, count);
+            failures++;
+        }
+
+        memcpy(expected, words, sizeof(words));
+        memcpy(bulk, words, sizeof(words));
+        should_raise = scalar_news(expected, count, width, lsb, svalues);
+        raised = bulk_news(bulk, count, width, lsb, svalues);
+        if (raised != should_raise || memcmp(bulk, should_raise ? words 
+                                             : expected, 
+                                             count * sizeof(*bulk)) != 0) {
+            printf("news: width %u lsb %u count %d\n", width, lsb, count);
+            failures++;
+        }
+    }
+
+    if (failures > 0) {
+        printf("%d bulk failures\n", failures);
+        exit(EXIT_FAILURE);
+    }
+    printf("bulk functions match the scalar ones\n");
+}
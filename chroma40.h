@@ -0,0 +1,72 @@
+/*
+ * chroma40.h
+ * Purpose: Inline chroma quantizer which maps average Pb/Pr values to 4-bit
+ *          indices and back with the same table and nearest-value search as
+ *          Arith40_index_of_chroma and Arith40_chroma_of_index, so the 
+ *          hot loops need no calls into libarith40
+ */
+#ifndef CHROMA40_INCLUDED
+#define CHROMA40_INCLUDED
+
+#include <math.h>
+#include "assert.h"
+
+/* 
+ * building with -DCHECK_ARITH40 (and -larith40) checks every index against
+ * the library
+ */
+#ifdef CHECK_ARITH40
+#include "arith40.h"
+#endif
+
+#define CHROMA40_COUNT 16
+#define CHROMA40_LIMIT 0.5f     /* values are clamped to [-0.5, 0.5] first */
+
+/* the chroma values of libarith40, in increasing order */
+static const float chroma40_values[CHROMA40_COUNT] = {
+    -0.35, -0.20, -0.15, -0.10, -0.077, -0.055, -0.033, -0.011,
+    0.011, 0.033, 0.055, 0.077, 0.10, 0.15, 0.20, 0.35
+};
+
+/*
+ * chroma40_index_of
+ * Returns the index of the chroma value nearest to x, after clamping x to
+ * [-0.5, 0.5], taking the lower index when two are equally near, as 
+ * Arith40_index_of_chroma does. The distances grow away from the nearest 
+ * value, so counting the neighbours where the upper one is strictly nearer
+ * finds the same index without branches.
+ * Input: average chroma value of a block
+ * Output: index from 0 to 15
+ */
+static inline unsigned chroma40_index_of(float x)
+{
+    unsigned index = 0;
+    float clamped = x > CHROMA40_LIMIT ? CHROMA40_LIMIT : x;
+    clamped = clamped < -CHROMA40_LIMIT ? -CHROMA40_LIMIT : clamped;
+
+    for (int i = 0; i < CHROMA40_COUNT - 1; i++) {
+        float below = clamped - chroma40_values[i];
+        float above = clamped - chroma40_values[i + 1];
+        index += fabsf(above) < fabsf(below);
+    }
+
+#ifdef CHECK_ARITH40
+    assert(index == Arith40_index_of_chroma(x));
+#endif
+    return index;
+}
+
+/*
+ * chroma40_of_index
+ * Returns the chroma value of a 4-bit index, as Arith40_chroma_of_index does
+ * Input: index from 0 to 15
+ * Output: For valid inputs, the chroma value
+ *         For invalid inputs (index above 15), CRE and program exits
+ */
+static inline float chroma40_of_index(unsigned index)
+{
+    assert(index < CHROMA40_COUNT);
+    return chroma40_values[index];
+}
+
+#endif
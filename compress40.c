@@ -11,16 +11,17 @@
 #include <stdio.h>
 #include "a2blocked.h"
 #include "a2plain.h"
-#include "arith40.h"
+#include "a2extra.h"
 #include "assert.h"
 #include "pnm.h"
 #include "bitpack.h"
 #include "convert40.h"
 #include "math40.h"
 #include "pack40.h"
-
-#define BYTE_SIZE 8
-#define WORD_SIZE 32
+#include "parallel40.h"
+#include "simd40.h"
+#include "fixed40.h"
+#include "words40.h"
 
 #define US_TYPE uint64_t
 
@@ -29,24 +30,33 @@
 
 typedef A2Methods_UArray2 A2;
 
-/* closure for apply_compression function */
+/* closure for compress_band function */
 typedef struct compression_cl {
     Pnm_ppm image;
     A2 word_arr;
 }compression_cl;
 
+/* closure for decompress_band function */
+typedef struct decompression_cl {
+    Pnm_ppm image;
+    A2 words;
+}decompression_cl;
+
 /* COMPRESSION FUNCTIONS */
 void compress40(FILE *fp);
 Pnm_ppm read_ppm(FILE *fp, A2Methods_T methods);
-void apply_compression(int col, int row, A2 array, void *elem, void *cl);
+void compress_band(int first_row, int last_row, void *cl);
+void read_scanline(Pnm_ppm image, int row, struct Pnm_rgb *line);
 void print_compressed(A2 words, A2Methods_T methods, int width, int height);
-void apply_print(int col, int row, A2 array, void *elem, void *cl);
+void write_words_row(int row, A2Methods_Object *first, int count, void *cl);
 
 /* DECOMPRESSION FUNCTIONS */
 void decompress40(FILE *fp);
 void run_decompression(FILE *fp, Pnm_ppm image);
 A2 read_words(FILE *fp, int words_width, int words_height);
-void apply_decompression(int col, int row, A2 array, void *elem, void *cl);
+void read_words_row(int row, A2Methods_Object *first, int count, void *cl);
+void decompress_band(int first_row, int last_row, void *cl);
+void write_scanline(Pnm_ppm image, int row, unsigned char *line, int count);
 
 
 /////////////////////////////
@@ -80,7 +90,8 @@ void compress40 (FILE *fp)
                                       image->height / BSIZE,
                                       sizeof(US_TYPE));
     
-    methods_blocked->map_block_major(image->pixels, apply_compression, cl);
+    /* bands of word rows are independent, so split them between threads */
+    parallel40_map_bands(image->height / BSIZE, compress_band, cl);
     
     print_compressed(cl->word_arr, methods_plain, image->width, image->height);
     
@@ -118,50 +129,75 @@ Pnm_ppm read_ppm(FILE *fp, A2Methods_T methods)
 }
 
 /*
- * apply_compression
- * Iterates through the pixel array of an image and performs the actions 
- * necessary to compress the pixels
- * Input: integers representing column and row of the pixel array, 
- *        A2Methods_UArray2 through which to iterate, void pointer to 
- *        element in the array, void pointer to the Pnm_ppm struct of the image
+ * compress_band
+ * Compresses every block in a horizontal band of the image, storing the 
+ * codewords for rows first_row up to last_row of the word array. The two 
+ * scanlines of each row of blocks are copied out of the image and then 
+ * compressed by the vectorized encoder.
+ * Input: integers representing the first and one past the last row of the 
+ *        word array in the band, void pointer to the compression_cl of the 
+ *        image
  * Output: For valid inputs, void
- *         For invalid inputs, (null Pnm_ppm image passed in), CRE and program
- *         exits
+ *         For invalid inputs, (null closure), CRE and program exits
  */
-void apply_compression(int col, int row, A2 array, void *elem, void *cl) 
+void compress_band(int first_row, int last_row, void *cl)
 {
-    (void)array;
-    (void)elem;
-    
-    compression_cl closure = (*(compression_cl *) cl);
-    assert(cl != NULL);
-    
-    Pnm_ppm image = (Pnm_ppm) closure.image;
-    assert(image != NULL);
+    compression_cl *closure = cl;
+    assert(closure != NULL);
     
     A2Methods_T methods_plain = uarray2_methods_plain;
-    A2 words = (A2)closure.word_arr;
+    Pnm_ppm image = closure->image;
+    int words_width = image->width / BSIZE;
     
-    int denominator = image->denominator;
+    struct Pnm_rgb *top = malloc(image->width * sizeof(*top));
+    struct Pnm_rgb *bottom = malloc(image->width * sizeof(*bottom));
+    assert(top != NULL && bottom != NULL);
     
-    /* only applies when in bottom right corner of a block */
-    if (col % 2 == 1 && row % 2 == 1) {
-        Pnm_rgb pixel_tl = image->methods->at(image->pixels, col - 1, row - 1);
-        Pnm_rgb pixel_tr = image->methods->at(image->pixels, col, row - 1);
-        Pnm_rgb pixel_ll = image->methods->at(image->pixels, col - 1, row);
-        Pnm_rgb pixel_lr = image->methods->at(image->pixels, col, row);
-        
-        /* store pixels in block and convert from rgb to colorspace values */
-        colorspace_block cv_block = store_colorspace(pixel_tl, pixel_tr, 
-                                                     pixel_ll, pixel_lr, 
-                                                     denominator);
-        dctspace dct = cv_to_dct(cv_block);
-        quant_dct qdct = quantize(dct);
-        US_TYPE word = pack(qdct);
+    for (int row = first_row; row < last_row; row++) {
+        read_scanline(image, row * 2, top);
+        read_scanline(image, row * 2 + 1, bottom);
         
-        /* store packed codeword into array */
-        *((US_TYPE *)methods_plain->at(words, col / 2, row / 2)) = word;
+        /* each row of the plain word array is contiguous */
+        US_TYPE *words = methods_plain->at(closure->word_arr, 0, row);
+        if (fixed40_enabled()) {
+            fixed40_encode_row(top, bottom, words_width, image->denominator,
+                               words);
+        } else {
+            simd40_encode_row(top, bottom, words_width, image->denominator, 
+                              words);
+        }
     }
+    
+    free(top);
+    free(bottom);
+}
+
+/*
+ * read_scanline
+ * Copies one scanline of the image into an array of pixels, checking that
+ * every sample is at most the denominator, since the encoders index tables
+ * of denominator + 1 entries with the samples
+ * Input: Pnm_ppm struct of the image, integer representing the row to copy,
+ *        array of at least image->width pixels to fill
+ * Output: For valid inputs, void (line holds the pixels of the row)
+ *         For invalid inputs, (null image or line, sample above the 
+ *         denominator), CRE and program exits
+ */
+void read_scanline(Pnm_ppm image, int row, struct Pnm_rgb *line)
+{
+    assert(image != NULL);
+    assert(line != NULL);
+    
+    unsigned largest = 0;
+    for (unsigned col = 0; col < image->width; col++) {
+        line[col] = *(Pnm_rgb) image->methods->at(image->pixels, col, row);
+        unsigned samples[3] = { line[col].red, line[col].green, 
+                                line[col].blue };
+        for (int i = 0; i < 3; i++) {
+            largest = samples[i] > largest ? samples[i] : largest;
+        }
+    }
+    assert(largest <= image->denominator);
 }
 
 /*
@@ -177,38 +213,25 @@ void apply_compression(int col, int row, A2 array, void *elem, void *cl)
 void print_compressed(A2 words, A2Methods_T methods, int width, int height)
 {
     assert(words != NULL);
+    assert(methods == uarray2_methods_plain);
     
     printf("COMP40 Compressed image format 2\n%u %u\n", width, height);
-    methods->map_row_major(words, apply_print, NULL);
+    
+    /* each row of the plain word array is contiguous */
+    uarray2_extra_plain->map_rows(words, write_words_row, stdout);
 }
 
 /*
- * apply_print
- * Iterates through the UArray2 of words to print out each word after
- * compression has been performed
- * Input: integers representing column and row of the word array, 
- *        A2Methods_UArray2 through which to iterate, void pointer to 
- *        element in the array, void pointer cl (null parameters)
- * Output: For valid inputs, void, printing out the words in the array
- *         For invalid inputs, (null array elem), CRE and program
- *         exits
+ * write_words_row
+ * Writes one row of the word array to the file in the closure
+ * Input: row number (unused), pointer to the first of count words in the
+ *        row, file stream pointer to write to
+ * Output: void (the words are written)
  */
-void apply_print(int col, int row, A2 array, void *elem, void *cl)
+void write_words_row(int row, A2Methods_Object *first, int count, void *cl)
 {
-    assert(elem != NULL);
-    
-    (void)col;
     (void)row;
-    (void)array;
-    (void)cl;
-    
-    US_TYPE word = (*(US_TYPE*) elem);
-    
-    for (int i = 0; i < WORD_SIZE / BYTE_SIZE; i++) {
-        char byte = Bitpack_getu(word, BYTE_SIZE, 
-                                WORD_SIZE - (BYTE_SIZE * (i + 1)));
-        putchar(byte);
-    }
+    words40_write(cl, first, count);
 }
 
 /////////////////////////////
@@ -273,7 +296,9 @@ void run_decompression(FILE *fp, Pnm_ppm image)
     A2Methods_T methods_plain = uarray2_methods_plain;
     A2 words = read_words(fp, words_width, words_height);
     
-    methods_plain->map_row_major(words, apply_decompression, image);
+    /* each word fills its own 2x2 block, so rows of words are independent */
+    decompression_cl cl = { .image = image, .words = words };
+    parallel40_map_bands(words_height, decompress_band, &cl);
     
     methods_plain->free(&words);
 }
@@ -284,7 +309,8 @@ void run_decompression(FILE *fp, Pnm_ppm image)
  * Takes a file and reads the words, storing the words into a 2d array   
  * Input: File stream pointer which contains the words, cre if NULL
  * Output: A 2d array of words for valid input
- *         For invalid inputs, null file pointer, CRE and program exits
+ *         For invalid inputs, null file pointer, payload shorter or longer
+ *         than the header says, CRE and program exits
  */
 A2 read_words(FILE *fp, int words_width, int words_height)
 {
@@ -293,59 +319,94 @@ A2 read_words(FILE *fp, int words_width, int words_height)
     A2Methods_T methods_plain = uarray2_methods_plain;
     A2 words = methods_plain->new(words_width, words_height, sizeof(US_TYPE));
     
-    int num_words = words_width * words_height;
+    /* the whole payload, checked against the header, with one read */
+    uint32_t *payload = words40_load(fp, (size_t)words_width * words_height);
     
-    for (int i = 0; i < num_words; i++) {
-        US_TYPE pixel = 0;
-        
-        for (int j = 0; j < WORD_SIZE / BYTE_SIZE; j++) {
-            int byte = fgetc(fp);
-            assert(byte != EOF); /* check if supplied file is too short */
-            pixel = Bitpack_newu(pixel, 
-                                 BYTE_SIZE, 
-                                 WORD_SIZE - (BYTE_SIZE * (j + 1)), 
-                                 byte); 
-        }
-        
-        int pix_col = i % (words_width);
-        int pix_row = i / (words_width);
-        
-        *((US_TYPE *)methods_plain->at(words, pix_col, pix_row)) = pixel;
-    }
+    /* each row of the plain word array is contiguous */
+    uarray2_extra_plain->map_rows(words, read_words_row, payload);
+    
+    free(payload);
     return words;    
 }
 
 /*
- * apply_decompression
- * Iterates through the array of words and performs the actions 
- * necessary to decompress the pixels
- * Input: integers representing column and row of the word array, 
- *        A2Methods_UArray2 through which to iterate, void pointer to 
- *        element in the array, void pointer to the Pnm_ppm struct of the image
+ * read_words_row
+ * Fills one row of the word array from the payload in the closure
+ * Input: row number, pointer to the first of count words in the row, 
+ *        payload of big-endian 32-bit words read by words40_load
+ * Output: void (the row holds its codewords)
+ */
+void read_words_row(int row, A2Methods_Object *first, int count, void *cl)
+{
+    const uint32_t *payload = cl;
+    words40_unpack(&payload[(size_t)row * count], first, count);
+}
+
+/*
+ * decompress_band
+ * Decompresses every word in rows first_row up to last_row of the word array
+ * into the matching horizontal band of the image. Each row of words is 
+ * decoded into two scanlines by the vectorized decoder, which are then 
+ * copied into the image.
+ * Input: integers representing the first and one past the last row of the 
+ *        word array in the band, void pointer to the decompression_cl of the 
+ *        image
  * Output: For valid inputs, void
- *         For invalid inputs, (null Pnm_ppm image passed in), CRE and program
- *         exits
+ *         For invalid inputs, (null closure), CRE and program exits
  */
-void apply_decompression(int col, int row, A2 array, void *elem, void *cl)
+void decompress_band(int first_row, int last_row, void *cl)
 {
-    (void)array;
-    
-    Pnm_ppm image = (Pnm_ppm) cl;
-    assert(image != NULL);
-    
-    US_TYPE word = *(US_TYPE *) elem;
+    decompression_cl *closure = cl;
+    assert(closure != NULL);
     
-    /* Converts words to luminence/Pb/Pr and to colorspace values */
-    quant_dct qdct = unpack(word);
-    dctspace dct = dequantize(qdct);
-    colorspace_block cv_block = dct_to_cv(dct);
-    
-    col = col * 2 + 1;
-    row = row * 2 + 1;
+    A2Methods_T methods_plain = uarray2_methods_plain;
+    Pnm_ppm image = closure->image;
+    int words_width = methods_plain->width(closure->words);
+    
+    /* two scanlines of 3 bytes per pixel */
+    unsigned char *top = malloc(image->width * 3);
+    unsigned char *bottom = malloc(image->width * 3);
+    assert(image->width == 0 || (top != NULL && bottom != NULL));
+    
+    for (int row = first_row; row < last_row && words_width > 0; row++) {
+        /* each row of the plain word array is contiguous */
+        US_TYPE *words = methods_plain->at(closure->words, 0, row);
+        if (fixed40_enabled()) {
+            fixed40_decode_row(words, words_width, top, bottom);
+        } else {
+            simd40_decode_row(words, words_width, top, bottom);
+        }
+        
+        /* an odd last column is not covered by a block and stays zero */
+        write_scanline(image, row * 2, top, words_width * 2);
+        write_scanline(image, row * 2 + 1, bottom, words_width * 2);
+    }
     
-    /* Converts colorspace to rgb in pixel block */
-    set_cv_to_rgb(col - 1, row - 1, cv_block.tl, image);
-    set_cv_to_rgb(col, row - 1, cv_block.tr, image);
-    set_cv_to_rgb(col - 1, row, cv_block.ll, image);
-    set_cv_to_rgb(col, row, cv_block.lr, image);
-}
\ No newline at end of file
+    free(top);
+    free(bottom);
+}
+
+/*
+ * write_scanline
+ * Copies the first count pixels of a scanline of 8-bit rgb samples into a
+ * row of the image
+ * Input: Pnm_ppm struct of the image, integer representing the row to fill,
+ *        array of count * 3 samples, number of pixels to copy (at most
+ *        image->width)
+ * Output: For valid inputs, void (the row of the image holds the samples)
+ *         For invalid inputs, (null image or line, count too large), CRE and
+ *         program exits
+ */
+void write_scanline(Pnm_ppm image, int row, unsigned char *line, int count)
+{
+    assert(image != NULL);
+    assert(line != NULL);
+    assert(count >= 0 && (unsigned)count <= image->width);
+    
+    for (int col = 0; col < count; col++) {
+        Pnm_rgb pixel = image->methods->at(image->pixels, col, row);
+        pixel->red = line[3 * col];
+        pixel->green = line[3 * col + 1];
+        pixel->blue = line[3 * col + 2];
+    }
+}
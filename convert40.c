@@ -9,11 +9,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "assert.h"
-#include "arith40.h"
+#include "chroma40.h"
 #include "convert40.h"
 #include "compress40.h"
 #include "pnm.h"
 #include "math40.h"
+#include "ypbpr40.h"
 
 #define BCD_COEFF 103
 #define A_COEFF 63
@@ -24,26 +25,33 @@
 /*
  * rgb_to_cv
  * Converts the rgb values in a pixel to component video color space values 
- * (Y/Pb/Pr), then returns these values stored in a colorspace struct
+ * (Y/Pb/Pr) with the lookup table for the denominator, then returns these
+ * values stored in a colorspace struct
  * Input: Pnm_rgb Pixel to be converted, integer representing denominator of
  *        the image
  * Output: For valid inputs, a structure containing the component video color
  *         space values for the pixel specified
- *         For invalid inputs (null pixel), program exits with a CRE
+ *         For invalid inputs (null pixel, sample above denom), program 
+ *         exits with a CRE
  */
 colorspace rgb_to_cv(Pnm_rgb pixel, int denom)
 {
     assert(pixel != NULL);
     
+    /* the table has an entry for each sample from 0 to denom */
+    assert(pixel->red <= (unsigned)denom && pixel->green <= (unsigned)denom &&
+           pixel->blue <= (unsigned)denom);
+    
     colorspace cv;
 
-    float r = (float)pixel->red / (float) denom;
-    float g = (float)pixel->green / (float) denom;
-    float b = (float)pixel->blue / (float) denom;
+    const ypbpr_table *table = ypbpr40_table(denom);
+    ypbpr_terms r = table->red[pixel->red];
+    ypbpr_terms g = table->green[pixel->green];
+    ypbpr_terms b = table->blue[pixel->blue];
     
-    cv.y = 0.299 * r + 0.587 * g + 0.114 * b;
-    cv.pb = -0.168736 * r - 0.331264 * g + 0.5 * b;
-    cv.pr = 0.5 * r - 0.418688 * g - 0.081312 * b;
+    cv.y = r.y + g.y + b.y;
+    cv.pb = r.pb + g.pb + b.pb;
+    cv.pr = r.pr + g.pr + b.pr;
     
     return cv;
 }
@@ -60,14 +68,8 @@ void set_cv_to_rgb(int col, int row, colorspace cv, Pnm_ppm image)
 {
     assert(image != NULL);
     
-    Pnm_rgb converted_pixel = cv_to_rgb(cv, image->denominator);
     Pnm_rgb pixel = image->methods->at(image->pixels, col, row);
-    
-    pixel->red = converted_pixel->red;
-    pixel->green = converted_pixel->green;
-    pixel->blue = converted_pixel->blue;
-    
-    free(converted_pixel);
+    *pixel = cv_to_rgb(cv, image->denominator);
 }
 
 /*
@@ -76,24 +78,24 @@ void set_cv_to_rgb(int col, int row, colorspace cv, Pnm_ppm image)
  * these values in a Pnm_rgb struct
  * Input: colorspace struct to be converted, integer representing denominator of
  *        the image
- * Output: For valid inputs, a structure containing the rgb values of the pixel
+ * Output: For valid inputs, a structure containing the rgb values of the pixel,
+ *         returned by value so that no memory is allocated
  */
-Pnm_rgb cv_to_rgb(colorspace cv, int denominator) 
+struct Pnm_rgb cv_to_rgb(colorspace cv, int denominator) 
 {
     float r = 1.0 * cv.y + 0.0 * cv.pb + 1.402 * cv.pr;
     float g = 1.0 * cv.y - 0.344136 * cv.pb - 0.714136 * cv.pr;
     float b = 1.0 * cv.y + 1.772 * cv.pb + 0.0 * cv.pr;
     
-    Pnm_rgb pixel = malloc(sizeof(*pixel));
-    assert(pixel != NULL);
+    struct Pnm_rgb pixel;
     
     int red = round_float(r * denominator);
     int green = round_float(g * denominator);
     int blue = round_float(b * denominator);
     
-    pixel->red = check_range((float) red, (float) DENOMINATOR, 0.0);
-    pixel->green = check_range((float) green, (float) DENOMINATOR, 0.0);
-    pixel->blue = check_range((float) blue, (float) DENOMINATOR, 0.0);
+    pixel.red = check_range((float) red, (float) DENOMINATOR, 0.0);
+    pixel.green = check_range((float) green, (float) DENOMINATOR, 0.0);
+    pixel.blue = check_range((float) blue, (float) DENOMINATOR, 0.0);
     
     return pixel;
 }
@@ -202,8 +204,8 @@ quant_dct quantize(dctspace dct)
 {
     quant_dct qdct;
     
-    qdct.pr = Arith40_index_of_chroma(dct.pr);
-    qdct.pb = Arith40_index_of_chroma(dct.pb);
+    qdct.pr = chroma40_index_of(dct.pr);
+    qdct.pb = chroma40_index_of(dct.pb);
     
     qdct.a = round_float(A_COEFF * dct.a);
     qdct.b = round_float(BCD_COEFF * check_range(dct.b, MAX_BCD, MIN_BCD)); 
@@ -224,8 +226,8 @@ dctspace dequantize(quant_dct qdct)
 {
     dctspace dct;
     
-    dct.pr = Arith40_chroma_of_index(qdct.pr);
-    dct.pb = Arith40_chroma_of_index(qdct.pb);
+    dct.pr = chroma40_of_index(qdct.pr);
+    dct.pb = chroma40_of_index(qdct.pb);
     
     dct.a = (float) qdct.a / A_COEFF;
     dct.b = (float) qdct.b / BCD_COEFF;
@@ -234,3 +236,59 @@ dctspace dequantize(quant_dct qdct)
     
     return dct;
 }
+
+/*
+ * quantize_block
+ * Converts four rgb pixels straight to quantized dct values in a single pass,
+ * without building the intermediate colorspace_block and dctspace structs.
+ * Every value goes through the same table lookups and float operations in
+ * the same order as store_colorspace, cv_to_dct and quantize, so the result
+ * is bit-for-bit the same.
+ * Input: Pnm_rgb pixels of the block (four), integer representing denominator
+ *        of the image
+ * Output: For valid inputs, a structure containing the quantized dct values
+ *         For invalid inputs (null pixels, sample above denom), CRE and 
+ *         program exits
+ */
+quant_dct quantize_block(Pnm_rgb tl, Pnm_rgb tr, Pnm_rgb ll, Pnm_rgb lr, 
+                         int denom)
+{
+    assert(tl != NULL && tr != NULL && ll != NULL && lr != NULL);
+    
+    Pnm_rgb pixels[4] = { tl, tr, ll, lr };
+    float y[4], pb[4], pr[4];
+    const ypbpr_table *table = ypbpr40_table(denom);
+    
+    for (int i = 0; i < 4; i++) {
+        assert(pixels[i]->red <= (unsigned)denom && 
+               pixels[i]->green <= (unsigned)denom &&
+               pixels[i]->blue <= (unsigned)denom);
+        ypbpr_terms r = table->red[pixels[i]->red];
+        ypbpr_terms g = table->green[pixels[i]->green];
+        ypbpr_terms b = table->blue[pixels[i]->blue];
+        
+        y[i] = r.y + g.y + b.y;
+        pb[i] = r.pb + g.pb + b.pb;
+        pr[i] = r.pr + g.pr + b.pr;
+    }
+    
+    float ave_pb = (pb[0] + pb[1] + pb[2] + pb[3]) / 4.0;
+    float ave_pr = (pr[0] + pr[1] + pr[2] + pr[3]) / 4.0;
+    
+    float a = (y[3] + y[2] + y[1] + y[0]) / 4.0;
+    float b = (y[3] + y[2] - y[1] - y[0]) / 4.0;
+    float c = (y[3] - y[2] + y[1] - y[0]) / 4.0;
+    float d = (y[3] - y[2] - y[1] + y[0]) / 4.0;
+    
+    quant_dct qdct;
+    
+    qdct.pr = chroma40_index_of(ave_pr);
+    qdct.pb = chroma40_index_of(ave_pb);
+    
+    qdct.a = round_float(A_COEFF * a);
+    qdct.b = round_float(BCD_COEFF * check_range(b, MAX_BCD, MIN_BCD)); 
+    qdct.c = round_float(BCD_COEFF * check_range(c, MAX_BCD, MIN_BCD)); 
+    qdct.d = round_float(BCD_COEFF * check_range(d, MAX_BCD, MIN_BCD));
+    
+    return qdct;
+}
@@ -57,9 +57,9 @@ colorspace rgb_to_cv(Pnm_rgb pixel, int denom);
 /*
  * cv_to_rgb
  * Converts the component video color space values to RGB values, then returns
- * these values in a Pnm_rgb struct
+ * these values by value in a Pnm_rgb struct
 */
-Pnm_rgb cv_to_rgb(colorspace cv, int denominator); 
+struct Pnm_rgb cv_to_rgb(colorspace cv, int denominator); 
 
 /*
  * set_cv_to_rgb
@@ -107,4 +107,13 @@ quant_dct quantize(dctspace dct);
  */
 dctspace dequantize(quant_dct qdct);
 
+/* FUSED ENCODER */
+/*
+ * quantize_block
+ * Converts four rgb pixels straight to quantized dct values in a single pass,
+ * giving the same result as store_colorspace, cv_to_dct and quantize
+ */
+quant_dct quantize_block(Pnm_rgb tl, Pnm_rgb tr, Pnm_rgb ll, Pnm_rgb lr, 
+                         int denom);
+
 #endif
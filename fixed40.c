@@ -0,0 +1,387 @@
+/*
+ * fixed40.c
+ * Purpose: Integer-only encoder which compresses 2x2 blocks with fixed-point
+ *          arithmetic, and a table-driven decoder which decompresses them
+ *          with table loads and integer adds, so that both give the same
+ *          output on every host
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "assert.h"
+#include "chroma40.h"
+#include "convert40.h"
+#include "pack40.h"
+#include "layout40.h"
+#include "fixed40.h"
+
+#define BCD_COEFF 103
+#define A_COEFF 63
+#define MAX_QBCD 30             /* BCD_COEFF * 0.3, truncated */
+
+#define NUM_CHROMA CHROMA40_COUNT
+#define CHROMA_ONE 65536        /* chroma thresholds are in units of 2^-16 */
+
+#define NUM_A (LAYOUT40_MASK_a + 1)
+#define NUM_BCD (LAYOUT40_MASK_b + 1)   /* b, c and d have the same width */
+#define NUM_PB (LAYOUT40_MASK_pb + 1)
+#define NUM_PR (LAYOUT40_MASK_pr + 1)
+#define NUM_CHROMA_PAIRS (NUM_PB << LAYOUT40_WIDTH_pr)
+
+/* 
+ * every chroma index must fit in pb and pr (the array size is negative, so
+ * the build fails, if one does not); wider fields also hold values no 
+ * encoder writes, which decode_block rejects
+ */
+typedef char pb_and_pr_hold_every_chroma_index
+    [NUM_PB >= NUM_CHROMA && NUM_PR >= NUM_CHROMA ? 1 : -1];
+#define WIDE_CHROMA (NUM_PB > NUM_CHROMA || NUM_PR > NUM_CHROMA)
+
+#define DENOMINATOR 255
+#define BYTES_PER_BLOCK 6       /* two rgb pixels in each scanline */
+#define CHUNK_BLOCKS 256        /* blocks packed at a time */
+#define SAMPLE_SHIFT 16         /* decode tables are in units of 2^-16 */
+
+/* 
+ * colour transform coefficients in units of 2^-14; each row of the Y/Pb/Pr 
+ * matrix is rounded so that it still sums to exactly 1 or 0
+ */
+#define COEFF_SHIFT 14
+#define Y_R 4899
+#define Y_G 9617
+#define Y_B 1868
+#define PB_R -2765
+#define PB_G -5427
+#define PB_B 8192
+#define PR_R 8192
+#define PR_G -6860
+#define PR_B -1332
+
+/* contributions of a chroma pair to each channel of a decoded pixel */
+typedef struct chroma_terms {
+    int32_t r, g, b;
+}chroma_terms;
+
+static bool enabled = false;
+
+/* midpoints between neighbouring chroma values, in units of 2^-16 */
+static int64_t chroma_thresholds[NUM_CHROMA - 1];
+static pthread_once_t thresholds_once = PTHREAD_ONCE_INIT;
+
+/* 
+ * contributions of each field of a codeword to the samples of a decoded 
+ * pixel, scaled by DENOMINATOR in units of 2^-16; bcd_terms is indexed by 
+ * the raw unsigned field, so it handles the sign, and chroma_pairs is 
+ * indexed by pb and pr side by side, so it has an entry for every value 
+ * of the two fields (those which are not chroma indices are left zero)
+ */
+static int32_t a_terms[NUM_A];
+static int32_t bcd_terms[NUM_BCD];
+static chroma_terms chroma_pairs[NUM_CHROMA_PAIRS];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static void make_thresholds(void);
+static void make_tables(void);
+static int32_t to_fixed(double value);
+static void decode_block(US_TYPE word, unsigned char *top,
+                         unsigned char *bottom);
+static void set_sample(unsigned char *sample, int32_t y, chroma_terms chroma);
+static unsigned char clamp_sample(int32_t value);
+static void encode_block(const struct Pnm_rgb *top,
+                         const struct Pnm_rgb *bottom, int64_t scale,
+                         quant_dct_n qdcts, int index);
+static int index_of_chroma(int64_t sum, int64_t scale);
+static int clamp_bcd(int64_t sum, int64_t scale);
+
+/*
+ * fixed40_set_enabled
+ * Selects whether compression and decompression use the fixed-point encoder
+ * and table-driven decoder instead of the float ones
+ * Input: true to use the fixed-point encoder and decoder
+ * Output: void
+ */
+void fixed40_set_enabled(bool use_fixed)
+{
+    enabled = use_fixed;
+}
+
+/*
+ * fixed40_enabled
+ * Returns whether the fixed-point encoder and decoder are selected
+ * Input: none
+ * Output: true if they are selected
+ */
+bool fixed40_enabled(void)
+{
+    return enabled;
+}
+
+/*
+ * fixed40_encode_row
+ * Compresses a row of num_blocks 2x2 blocks, taken from the pixels of two
+ * scanlines, into num_blocks codewords using only integer arithmetic
+ * Input: scanlines of at least 2 * num_blocks pixels for the top and bottom
+ *        of the blocks (cannot be null), number of blocks, denominator of
+ *        the image (positive), array of num_blocks words to fill (cannot be 
+ *        null)
+ * Output: For valid inputs, void (words holds the codewords of the blocks)
+ *         For invalid inputs (null arrays, bad denominator), CRE and program
+ *         exits
+ */
+void fixed40_encode_row(const struct Pnm_rgb *top, const struct Pnm_rgb *bottom,
+                        int num_blocks, int denom, US_TYPE *words)
+{
+    assert(top != NULL && bottom != NULL && words != NULL);
+    assert(denom > 0);
+
+    pthread_once(&thresholds_once, make_thresholds);
+
+    /* a sum over the 4 pixels of a block divided by scale is an average */
+    int64_t scale = ((int64_t)denom << COEFF_SHIFT) * 4;
+
+    int a[CHUNK_BLOCKS], b[CHUNK_BLOCKS], c[CHUNK_BLOCKS], d[CHUNK_BLOCKS];
+    int pb[CHUNK_BLOCKS], pr[CHUNK_BLOCKS];
+    quant_dct_n qdcts = { a, b, c, d, pb, pr };
+
+    /* quantize a chunk of blocks, then pack the whole chunk at once */
+    for (int first = 0; first < num_blocks; first += CHUNK_BLOCKS) {
+        int n = num_blocks - first < CHUNK_BLOCKS ? num_blocks - first 
+                                                  : CHUNK_BLOCKS;
+        for (int k = 0; k < n; k++) {
+            int i = first + k;
+            encode_block(&top[2 * i], &bottom[2 * i], scale, qdcts, k);
+        }
+        pack_n(qdcts, n, &words[first]);
+    }
+}
+
+/*
+ * fixed40_decode_row
+ * Decompresses a row of num_blocks codewords into two scanlines of
+ * interleaved 8-bit rgb samples, using tables of the contribution of each
+ * field of a codeword instead of float arithmetic
+ * Input: array of num_blocks codewords (cannot be null), number of blocks,
+ *        top and bottom scanlines of at least 6 * num_blocks bytes to fill
+ *        (cannot be null)
+ * Output: For valid inputs, void (top and bottom hold the decoded samples)
+ *         For invalid inputs (null arrays), CRE and program exits
+ */
+void fixed40_decode_row(const US_TYPE *words, int num_blocks,
+                        unsigned char *top, unsigned char *bottom)
+{
+    assert(words != NULL && top != NULL && bottom != NULL);
+
+    pthread_once(&tables_once, make_tables);
+
+    for (int i = 0; i < num_blocks; i++) {
+        decode_block(words[i], &top[BYTES_PER_BLOCK * i], 
+                     &bottom[BYTES_PER_BLOCK * i]);
+    }
+}
+
+/*
+ * make_thresholds
+ * Converts the midpoints between the chroma values of chroma40_of_index to
+ * fixed point, so that a chroma value can be quantized by comparisons
+ * Input: none
+ * Output: void (chroma_thresholds holds the midpoints)
+ *         If the chroma values are not increasing, CRE and program exits
+ */
+static void make_thresholds(void)
+{
+    for (int i = 0; i < NUM_CHROMA - 1; i++) {
+        double low = chroma40_of_index(i);
+        double high = chroma40_of_index(i + 1);
+        assert(low < high);
+
+        double middle = (low + high) / 2 * CHROMA_ONE;
+        chroma_thresholds[i] = middle < 0 ? (int64_t)(middle - 0.5)
+                                          : (int64_t)(middle + 0.5);
+    }
+}
+
+/*
+ * make_tables
+ * Fills the decode tables with the dequantized value of every a, b, c and d
+ * field and the rgb contributions of every pb/pr pair, whose chroma values
+ * come from chroma40_of_index
+ * Input: none
+ * Output: void (a_terms, bcd_terms and chroma_pairs are filled)
+ */
+static void make_tables(void)
+{
+    for (int a = 0; a < NUM_A; a++) {
+        a_terms[a] = to_fixed((double) a / A_COEFF);
+    }
+    for (int field = 0; field < NUM_BCD; field++) {
+        /* sign extend the field */
+        int bcd = field < NUM_BCD / 2 ? field : field - NUM_BCD;
+        bcd_terms[field] = to_fixed((double) bcd / BCD_COEFF);
+    }
+    for (int pair = 0; pair < NUM_CHROMA_PAIRS; pair++) {
+        unsigned pb_index = pair >> LAYOUT40_WIDTH_pr;
+        unsigned pr_index = pair & LAYOUT40_MASK_pr;
+        if (pb_index >= NUM_CHROMA || pr_index >= NUM_CHROMA) {
+            continue;
+        }
+        double pb = chroma40_of_index(pb_index);
+        double pr = chroma40_of_index(pr_index);
+
+        chroma_pairs[pair].r = to_fixed(1.402 * pr);
+        chroma_pairs[pair].g = to_fixed(-0.344136 * pb - 0.714136 * pr);
+        chroma_pairs[pair].b = to_fixed(1.772 * pb);
+    }
+}
+
+/*
+ * to_fixed
+ * Scales a value in the range of a sample to DENOMINATOR in units of 2^-16,
+ * rounding to the nearest unit
+ * Input: the value, with 1.0 being the brightest sample
+ * Output: the value in fixed point
+ */
+static int32_t to_fixed(double value)
+{
+    double scaled = value * DENOMINATOR * (1 << SAMPLE_SHIFT);
+
+    return scaled < 0 ? (int32_t)(scaled - 0.5) : (int32_t)(scaled + 0.5);
+}
+
+/*
+ * decode_block
+ * Decompresses one codeword into its 2x2 block with the decode tables
+ * Input: the codeword, top and bottom scanlines of 6 bytes to fill
+ * Output: For valid inputs, void (top and bottom hold the decoded samples)
+ *         For invalid inputs (pb or pr not a chroma index, possible only 
+ *         with fields wider than 4 bits), CRE and program exits
+ */
+static void decode_block(US_TYPE word, unsigned char *top,
+                         unsigned char *bottom)
+{
+    uint32_t w = word;
+    int32_t a = a_terms[LAYOUT40_GETU(a, w)];
+    int32_t b = bcd_terms[LAYOUT40_GETU(b, w)];
+    int32_t c = bcd_terms[LAYOUT40_GETU(c, w)];
+    int32_t d = bcd_terms[LAYOUT40_GETU(d, w)];
+    uint32_t pb = LAYOUT40_GETU(pb, w);
+    uint32_t pr = LAYOUT40_GETU(pr, w);
+
+    /* as chroma40_of_index does; a constant false for 4-bit fields */
+    if (WIDE_CHROMA) {
+        assert(pb < NUM_CHROMA && pr < NUM_CHROMA);
+    }
+    chroma_terms chroma = chroma_pairs[pb << LAYOUT40_WIDTH_pr | pr];
+
+    /* inverse dct, as in dct_to_cv */
+    set_sample(&top[0], a - b - c + d, chroma);
+    set_sample(&top[3], a - b + c - d, chroma);
+    set_sample(&bottom[0], a + b - c - d, chroma);
+    set_sample(&bottom[3], a + b + c + d, chroma);
+}
+
+/*
+ * set_sample
+ * Converts the luma and chroma of a pixel to its rgb samples
+ * Input: 3 bytes of a scanline to fill, luma of the pixel, chroma 
+ *        contributions of the block, both in units of 2^-16
+ * Output: void (sample holds the red, green and blue of the pixel)
+ */
+static void set_sample(unsigned char *sample, int32_t y, chroma_terms chroma)
+{
+    sample[0] = clamp_sample(y + chroma.r);
+    sample[1] = clamp_sample(y + chroma.g);
+    sample[2] = clamp_sample(y + chroma.b);
+}
+
+/*
+ * clamp_sample
+ * Truncates a fixed-point sample to an integer in the range 0 to DENOMINATOR
+ * Input: the sample in units of 2^-16
+ * Output: the clamped sample
+ */
+static unsigned char clamp_sample(int32_t value)
+{
+    if (value < 0) {
+        return 0;
+    }
+    value >>= SAMPLE_SHIFT;
+    return value > DENOMINATOR ? DENOMINATOR : value;
+}
+
+/*
+ * encode_block
+ * Quantizes the 2x2 block whose left pixels are top[0] and bottom[0]
+ * Input: top and bottom scanlines starting at the block, 4 times the 
+ *        denominator of the image in units of 2^-14, arrays of quantized 
+ *        values to fill, index of the block in the arrays
+ * Output: void (qdcts holds the quantized values of the block at index)
+ */
+static void encode_block(const struct Pnm_rgb *top,
+                         const struct Pnm_rgb *bottom, int64_t scale,
+                         quant_dct_n qdcts, int index)
+{
+    /* pixels are tl, tr, ll, lr as in colorspace_block */
+    const struct Pnm_rgb *pixels[4] = { &top[0], &top[1], &bottom[0], 
+                                        &bottom[1] };
+    int64_t y[4];
+    int64_t sum_pb = 0;
+    int64_t sum_pr = 0;
+
+    for (int p = 0; p < 4; p++) {
+        int64_t r = pixels[p]->red;
+        int64_t g = pixels[p]->green;
+        int64_t b = pixels[p]->blue;
+
+        y[p] = Y_R * r + Y_G * g + Y_B * b;
+        sum_pb += PB_R * r + PB_G * g + PB_B * b;
+        sum_pr += PR_R * r + PR_G * g + PR_B * b;
+    }
+
+    qdcts.a[index] = A_COEFF * (y[3] + y[2] + y[1] + y[0]) / scale;
+    qdcts.b[index] = clamp_bcd(y[3] + y[2] - y[1] - y[0], scale);
+    qdcts.c[index] = clamp_bcd(y[3] - y[2] + y[1] - y[0], scale);
+    qdcts.d[index] = clamp_bcd(y[3] - y[2] - y[1] + y[0], scale);
+    qdcts.pb[index] = index_of_chroma(sum_pb, scale);
+    qdcts.pr[index] = index_of_chroma(sum_pr, scale);
+}
+
+/*
+ * clamp_bcd
+ * Quantizes one of the b, c or d coefficients of a block, truncating toward
+ * zero and clamping to the range quantize allows
+ * Input: sum of the four luma values with the signs of the coefficient,
+ *        4 times the denominator in units of 2^-14
+ * Output: the quantized coefficient
+ */
+static int clamp_bcd(int64_t sum, int64_t scale)
+{
+    int64_t q = BCD_COEFF * sum / scale;
+
+    if (q > MAX_QBCD) {
+        return MAX_QBCD;
+    } else if (q < -MAX_QBCD) {
+        return -MAX_QBCD;
+    } else {
+        return q;
+    }
+}
+
+/*
+ * index_of_chroma
+ * Quantizes an average chroma value to the index of the nearest chroma value
+ * of chroma40_of_index
+ * Input: sum of the chroma of the four pixels of a block, 4 times the 
+ *        denominator in units of 2^-14
+ * Output: the chroma index
+ */
+static int index_of_chroma(int64_t sum, int64_t scale)
+{
+    int64_t value = sum * CHROMA_ONE;
+    int index = 0;
+
+    /* count the thresholds below the value, without branching */
+    for (int i = 0; i < NUM_CHROMA - 1; i++) {
+        index += value > chroma_thresholds[i] * scale;
+    }
+    return index;
+}
@@ -0,0 +1,47 @@
+/*
+ * fixed40.h
+ * Purpose: Interface to an integer-only encoder which compresses 2x2 blocks
+ *          with fixed-point arithmetic and a table-driven decoder, so that
+ *          both give the same output on every host
+ */
+#ifndef FIXED40_INCLUDED
+#define FIXED40_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pnm.h"
+
+#define US_TYPE uint64_t
+
+/*
+ * fixed40_set_enabled
+ * Selects whether compression and decompression use the fixed-point encoder
+ * and table-driven decoder instead of the float ones
+ */
+void fixed40_set_enabled(bool enabled);
+
+/*
+ * fixed40_enabled
+ * Returns whether the fixed-point encoder and decoder are selected
+ */
+bool fixed40_enabled(void);
+
+/*
+ * fixed40_encode_row
+ * Compresses a row of num_blocks 2x2 blocks, taken from the pixels of two
+ * scanlines, into num_blocks codewords using only integer arithmetic
+ */
+void fixed40_encode_row(const struct Pnm_rgb *top, const struct Pnm_rgb *bottom,
+                        int num_blocks, int denom, US_TYPE *words);
+
+/*
+ * fixed40_decode_row
+ * Decompresses a row of num_blocks codewords into two scanlines of
+ * interleaved 8-bit rgb samples (3 bytes per pixel, 2 pixels per block) with
+ * table loads and integer adds. The samples may differ by one from those of 
+ * the float decoder.
+ */
+void fixed40_decode_row(const US_TYPE *words, int num_blocks,
+                        unsigned char *top, unsigned char *bottom);
+
+#endif
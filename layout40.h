@@ -0,0 +1,127 @@
+/*
+ * layout40.h
+ * Purpose: Declares the layout of a 32 bit codeword once, as an X-macro, and
+ *          generates specialized inline code to pack and unpack its fields
+ *          with constant shifts and masks, through the unchecked Bitpack
+ *          functions. A different layout can be tried by defining 
+ *          LAYOUT40_FIELDS before this header is included (e.g. with 
+ *          -include on the command line).
+ */
+#ifndef LAYOUT40_INCLUDED
+#define LAYOUT40_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "convert40.h"
+#include "bitpack_unchecked.h"
+
+/*
+ * X(name, width, lsb, is_signed) for every field of a codeword. Names must
+ * be members of quant_dct, widths must be below 32, and the fields must fit
+ * in LAYOUT40_WORD_BITS without overlapping. pb and pr need at least 4 bits
+ * for the 16 chroma indices of chroma40.h; wider ones work, but their
+ * extra values are never written and are rejected when decoding.
+ */
+#ifndef LAYOUT40_FIELDS
+#define LAYOUT40_FIELDS(X) \
+    X(a, 6, 26, 0)         \
+    X(b, 6, 20, 1)         \
+    X(c, 6, 14, 1)         \
+    X(d, 6, 8, 1)          \
+    X(pb, 4, 4, 0)         \
+    X(pr, 4, 0, 0)
+#endif
+
+#define LAYOUT40_WORD_BITS 32
+
+/* LAYOUT40_WIDTH_a, LAYOUT40_LSB_a, LAYOUT40_MASK_a, ... for every field */
+#define LAYOUT40_CONSTANTS(name, width, lsb, is_signed) \
+    LAYOUT40_WIDTH_##name = (width),                    \
+    LAYOUT40_LSB_##name = (lsb),                        \
+    LAYOUT40_MASK_##name = (1 << (width)) - 1,          \
+    LAYOUT40_SIGNED_##name = (is_signed),
+
+enum { LAYOUT40_FIELDS(LAYOUT40_CONSTANTS) };
+
+/*
+ * Field operations on 32 bit words. They work on scalars and on GCC vector
+ * types alike: word and value must be unsigned (uint32_t or a vector of
+ * them), and itype is the matching signed type.
+ */
+#define LAYOUT40_INSERT(name, value) \
+    (((value) & LAYOUT40_MASK_##name) << LAYOUT40_LSB_##name)
+
+#define LAYOUT40_GETU(name, word) \
+    (((word) >> LAYOUT40_LSB_##name) & LAYOUT40_MASK_##name)
+
+/* signed fields are sign-extended by shifting them to the top first */
+#define LAYOUT40_GETS(name, word, itype)                                    \
+    ((itype)((word) << (LAYOUT40_WORD_BITS - LAYOUT40_LSB_##name -          \
+                        LAYOUT40_WIDTH_##name)) >>                          \
+     (LAYOUT40_WORD_BITS - LAYOUT40_WIDTH_##name))
+
+/*
+ * layout40_get_<name>, layout40_fits_<name>
+ * Extract a field from a word (sign-extended if the field is signed), and
+ * check whether a value fits in a field
+ */
+#define LAYOUT40_ACCESSORS(name, width, lsb, is_signed)                     \
+static inline int layout40_get_##name(uint32_t word)                        \
+{                                                                           \
+    return LAYOUT40_SIGNED_##name                                           \
+           ? (int)Bitpack_gets_unchecked(word, width, lsb)                  \
+           : (int)Bitpack_getu_unchecked(word, width, lsb);                 \
+}                                                                           \
+                                                                            \
+static inline bool layout40_fits_##name(int value)                          \
+{                                                                           \
+    return LAYOUT40_SIGNED_##name                                           \
+           ? value >= -(LAYOUT40_MASK_##name / 2 + 1) &&                    \
+             value <= LAYOUT40_MASK_##name / 2                              \
+           : value >= 0 && value <= LAYOUT40_MASK_##name;                   \
+}
+
+LAYOUT40_FIELDS(LAYOUT40_ACCESSORS)
+
+#define LAYOUT40_PACK_FIELD(name, width, lsb, is_signed)                    \
+    word = LAYOUT40_SIGNED_##name                                           \
+           ? Bitpack_news_unchecked(word, width, lsb, qdct.name)            \
+           : Bitpack_newu_unchecked(word, width, lsb, qdct.name);
+#define LAYOUT40_UNPACK_FIELD(name, width, lsb, is_signed) \
+    qdct.name = layout40_get_##name(word);
+#define LAYOUT40_FITS_FIELD(name, width, lsb, is_signed) \
+    && layout40_fits_##name(qdct.name)
+
+/*
+ * layout40_pack
+ * Packs the values of a block into a word; values are masked to their
+ * fields, so they must be checked with layout40_fits first
+ */
+static inline uint32_t layout40_pack(quant_dct qdct)
+{
+    uint64_t word = 0;
+    LAYOUT40_FIELDS(LAYOUT40_PACK_FIELD)
+    return word;
+}
+
+/*
+ * layout40_unpack
+ * Unpacks every field of a word into the values of a block
+ */
+static inline quant_dct layout40_unpack(uint32_t word)
+{
+    quant_dct qdct;
+    LAYOUT40_FIELDS(LAYOUT40_UNPACK_FIELD)
+    return qdct;
+}
+
+/*
+ * layout40_fits
+ * Returns whether every value of a block fits in its field
+ */
+static inline bool layout40_fits(quant_dct qdct)
+{
+    return true LAYOUT40_FIELDS(LAYOUT40_FITS_FIELD);
+}
+
+#endif
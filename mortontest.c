@@ -0,0 +1,177 @@
+/*
+ * mortontest.c
+ * Purpose: Checks UArray2m_at, UArray2m_map and UArray2m_map_quads against
+ *          a plain UArray2 holding the same values, on empty, single row and
+ *          column, odd and non-square arrays as well as random sizes
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "assert.h"
+#include "uarray2.h"
+#include "uarray2m.h"
+#include "a2methods.h"
+#include "a2morton.h"
+
+#define RANDOM_SIZES 500
+
+/* what the maps compare against */
+typedef struct expected {
+    UArray2_T plain;
+    UArray2m_T morton;
+    char *seen;             /* visits of each cell or group */
+    char *last;             /* previous element, to check Z-order */
+    int visits;
+    int failures;
+}expected;
+
+void test_size(int width, int height);
+void check_cell(int col, int row, UArray2m_T morton, void *elem, void *cl);
+void check_quad(int col, int row, void *tl, void *tr, void *ll, void *lr,
+                void *cl);
+void fail(expected *exp, const char *what, int col, int row);
+
+int main()
+{
+    int sizes[][2] = {
+        { 0, 0 }, { 0, 1 }, { 0, 7 }, { 7, 0 }, { 1, 1 }, { 1, 2 },
+        { 1, 7 }, { 7, 1 }, { 1, 64 }, { 64, 1 }, { 2, 2 }, { 2, 3 },
+        { 3, 5 }, { 5, 3 }, { 4, 17 }, { 17, 4 }, { 33, 65 }, { 64, 64 },
+        { 65, 2 }, { 100, 37 }, { 640, 481 }
+    };
+
+    printf("Testing fixed sizes ...\n");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        test_size(sizes[i][0], sizes[i][1]);
+    }
+
+    printf("Testing random sizes ...\n");
+    for (int i = 0; i < RANDOM_SIZES; i++) {
+        int limit = i % 10 == 0 ? 300 : 40;
+        test_size(rand() % limit, rand() % limit);
+    }
+
+    printf("Morton arrays match plain ones\n");
+    exit(EXIT_SUCCESS);
+}
+
+/*
+ * test_size
+ * Fills a Morton array and a plain one of width by height ints with the
+ * same values through their at functions, then checks that every cell
+ * reads back the same, that map visits every cell once in the order they
+ * are stored, and that map_quads visits every whole 2x2 group once. The
+ * A2Methods suite must give the same cells as UArray2m_at.
+ */
+void test_size(int width, int height)
+{
+    expected exp = {
+        .plain = UArray2_new(width, height, sizeof(int)),
+        .morton = UArray2m_new(width, height, sizeof(int)),
+        .seen = calloc((size_t)width * height + 1, 1),
+    };
+    assert(exp.seen != NULL);
+    A2Methods_T methods = uarray2_methods_morton;
+    A2Methods_UArray2 array = methods->new(width, height, sizeof(int));
+
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            int value = rand();
+            *(int *)UArray2_at(exp.plain, col, row) = value;
+            *(int *)UArray2m_at(exp.morton, col, row) = value;
+            *(int *)methods->at(array, col, row) = value;
+        }
+    }
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            int value = *(int *)UArray2_at(exp.plain, col, row);
+            if (*(int *)UArray2m_at(exp.morton, col, row) != value ||
+                *(int *)methods->at(array, col, row) != value) {
+                fail(&exp, "at", col, row);
+            }
+        }
+    }
+
+    UArray2m_map(exp.morton, check_cell, &exp);
+    if (exp.visits != width * height) {
+        fail(&exp, "map count", width, height);
+    }
+
+    exp.visits = 0;
+    for (int i = 0; i < width * height; i++) {
+        exp.seen[i] = 0;
+    }
+    UArray2m_map_quads(exp.morton, check_quad, &exp);
+    if (exp.visits != (width / 2) * (height / 2)) {
+        fail(&exp, "map_quads count", width, height);
+    }
+
+    if (exp.failures > 0) {
+        printf("%d failures for %d x %d\n", exp.failures, width, height);
+        exit(EXIT_FAILURE);
+    }
+    methods->free(&array);
+    UArray2m_free(&exp.morton);
+    UArray2_free(&exp.plain);
+    free(exp.seen);
+}
+
+/*
+ * check_cell
+ * Checks one cell visited by UArray2m_map: it is the cell UArray2m_at
+ * gives, it holds the value of the plain array, it was not visited before
+ * and it is stored after the previous one
+ */
+void check_cell(int col, int row, UArray2m_T morton, void *elem, void *cl)
+{
+    expected *exp = cl;
+    int width = UArray2m_width(morton);
+
+    if (col < 0 || col >= width || row < 0 ||
+        row >= UArray2m_height(morton)) {
+        fail(exp, "map bounds", col, row);
+        return;
+    }
+    if (elem != UArray2m_at(morton, col, row) ||
+        *(int *)elem != *(int *)UArray2_at(exp->plain, col, row) ||
+        exp->seen[row * width + col]++ != 0 ||
+        (exp->last != NULL && (char *)elem <= exp->last)) {
+        fail(exp, "map", col, row);
+    }
+    exp->last = elem;
+    exp->visits++;
+}
+
+/*
+ * check_quad
+ * Checks one group visited by UArray2m_map_quads: its four cells are the
+ * ones UArray2m_at gives for the group, and it was not visited before
+ */
+void check_quad(int col, int row, void *tl, void *tr, void *ll, void *lr,
+                void *cl)
+{
+    expected *exp = cl;
+    int groups_wide = UArray2m_width(exp->morton) / 2;
+
+    if (col < 0 || col >= groups_wide || row < 0 ||
+        row >= UArray2m_height(exp->morton) / 2) {
+        fail(exp, "map_quads bounds", col, row);
+        return;
+    }
+    if (tl != UArray2m_at(exp->morton, 2 * col, 2 * row) ||
+        tr != UArray2m_at(exp->morton, 2 * col + 1, 2 * row) ||
+        ll != UArray2m_at(exp->morton, 2 * col, 2 * row + 1) ||
+        lr != UArray2m_at(exp->morton, 2 * col + 1, 2 * row + 1) ||
+        exp->seen[row * groups_wide + col]++ != 0) {
+        fail(exp, "map_quads", col, row);
+    }
+    exp->visits++;
+}
+
+void fail(expected *exp, const char *what, int col, int row)
+{
+    if (exp->failures++ < 10) {
+        printf("%s: %d, %d\n", what, col, row);
+    }
+}
@@ -6,40 +6,39 @@
  *         on : 3/22/2021
  */
 
+#include "assert.h"
 #include "pack40.h"
 #include "compress40.h"
+#include "layout40.h"
 
-#define LSB_A 26
-#define LSB_B 20
-#define LSB_C 14
-#define LSB_D 8
-#define LSB_PB 4
-#define LSB_PR 0
+/* the pack_n and unpack_n steps for one field of block i */
+#define CHECK_FIELD(name, width, lsb, is_signed)                        \
+    | out_of_range(qdcts.name, count, LAYOUT40_MASK_##name,             \
+                   is_signed ? LAYOUT40_MASK_##name / 2 + 1 : 0)
+#define PACK_FIELD(name, width, lsb, is_signed) \
+    | LAYOUT40_INSERT(name, (uint32_t)qdcts.name[i])
+#define UNPACK_FIELD(name, width, lsb, is_signed) \
+    qdcts.name[i] = layout40_get_##name(word);
 
-#define WIDTHOF_A 6
-#define WIDTHOF_BCD 6
-#define WIDTHOF_PBPR 4
+static unsigned out_of_range(const int *values, int count, unsigned mask, 
+                             int bias);
 
 /*
  * pack
  * Packs luminence values of the pixel and average Pb and Pr indexes into a 32
- * bit word
+ * bit word laid out as in layout40.h
  * Input: A struct containing a, b, c, d, pb average, and pr average values 
  *        to be packed into a 32-bit word
  * Output: For valid inputs, returns a word
+ *         If a value does not fit in its field, Bitpack_Overflow is raised
  */
 US_TYPE pack(quant_dct qdct)
 {
-    US_TYPE word = 0;
+    if (!layout40_fits(qdct)) {
+        RAISE(Bitpack_Overflow);
+    }
     
-    word = Bitpack_newu(word, WIDTHOF_A, LSB_A, qdct.a);
-    word = Bitpack_news(word, WIDTHOF_BCD, LSB_B, qdct.b);
-    word = Bitpack_news(word, WIDTHOF_BCD, LSB_C, qdct.c);
-    word = Bitpack_news(word, WIDTHOF_BCD, LSB_D, qdct.d);
-    word = Bitpack_newu(word, WIDTHOF_PBPR, LSB_PB, qdct.pb);
-    word = Bitpack_newu(word, WIDTHOF_PBPR, LSB_PR, qdct.pr);
-    
-    return word;
+    return layout40_pack(qdct);
 }
 
 /*
@@ -52,14 +51,97 @@ US_TYPE pack(quant_dct qdct)
  */
 quant_dct unpack(US_TYPE word)
 {
-    quant_dct qdct;
-    
-    qdct.a = Bitpack_getu(word, WIDTHOF_A, LSB_A);
-    qdct.b = Bitpack_gets(word, WIDTHOF_BCD, LSB_B);
-    qdct.c = Bitpack_gets(word, WIDTHOF_BCD, LSB_C);
-    qdct.d = Bitpack_gets(word, WIDTHOF_BCD, LSB_D);
-    qdct.pb = Bitpack_getu(word, WIDTHOF_PBPR, LSB_PB);
-    qdct.pr = Bitpack_getu(word, WIDTHOF_PBPR, LSB_PR);
-    
-    return qdct;
-}
\ No newline at end of file
+    return layout40_unpack(word);
+}
+
+/*
+ * pack_n
+ * Packs the values of count blocks into count 32 bit words, giving the same
+ * words as pack. The ranges of all the values are checked once for the 
+ * whole batch, so the fields are then packed with plain shifts and the 
+ * loop can be vectorized.
+ * Input: arrays of count values for each field (cannot be null unless count
+ *        is 0), number of blocks, array of count words to fill (cannot be
+ *        null unless count is 0)
+ * Output: For valid inputs, void (words holds the packed words)
+ *         For invalid inputs (null arrays, a value which does not fit its
+ *         field), CRE and program exits
+ */
+void pack_n(quant_dct_n qdcts, int count, US_TYPE *words)
+{
+    assert(count >= 0);
+    if (count == 0) {
+        return;
+    }
+    assert(qdcts.a != NULL && qdcts.b != NULL && qdcts.c != NULL && 
+           qdcts.d != NULL && qdcts.pb != NULL && qdcts.pr != NULL);
+    assert(words != NULL);
+
+    /* signed values are biased to be unsigned before checking */
+    unsigned bad = 0 LAYOUT40_FIELDS(CHECK_FIELD);
+    assert(bad == 0);
+
+    for (int i = 0; i < count; i++) {
+        words[i] = 0 LAYOUT40_FIELDS(PACK_FIELD);
+    }
+}
+
+/*
+ * unpack_n
+ * Unpacks count words into the values of count blocks, giving the same
+ * values as unpack. Every field of a word is in range by construction, so
+ * no values are checked.
+ * Input: array of count words (cannot be null unless count is 0), number of
+ *        blocks, arrays of count values to fill for each field (cannot be 
+ *        null unless count is 0)
+ * Output: For valid inputs, void (qdcts holds the unpacked values)
+ *         For invalid inputs (null arrays), CRE and program exits
+ */
+void unpack_n(const US_TYPE *words, int count, quant_dct_n qdcts)
+{
+    assert(count >= 0);
+    if (count == 0) {
+        return;
+    }
+    assert(words != NULL);
+    assert(qdcts.a != NULL && qdcts.b != NULL && qdcts.c != NULL && 
+           qdcts.d != NULL && qdcts.pb != NULL && qdcts.pr != NULL);
+
+    for (int i = 0; i < count; i++) {
+        uint32_t word = words[i];
+        LAYOUT40_FIELDS(UNPACK_FIELD)
+    }
+}
+
+/*
+ * pack_block
+ * Converts four rgb pixels of a 2x2 block straight to a 32 bit codeword, 
+ * giving the same word as store_colorspace, cv_to_dct, quantize and pack
+ * Input: Pnm_rgb pixels of the block (four), integer representing denominator
+ *        of the image
+ * Output: For valid inputs, returns a word
+ *         For invalid inputs (null pixels), CRE and program exits
+ */
+US_TYPE pack_block(Pnm_rgb tl, Pnm_rgb tr, Pnm_rgb ll, Pnm_rgb lr, int denom)
+{
+    return pack(quantize_block(tl, tr, ll, lr, denom));
+}
+
+/*
+ * out_of_range
+ * Checks whether any of count values, after adding bias, has bits outside
+ * mask. The bits are gathered without branching so the loop vectorizes.
+ * Input: array of count values, number of values, mask of the bits a value
+ *        may use, bias which moves a signed range to start at zero
+ * Output: 0 if every value fits, nonzero otherwise
+ */
+static unsigned out_of_range(const int *values, int count, unsigned mask, 
+                             int bias)
+{
+    unsigned bits = 0;
+
+    for (int i = 0; i < count; i++) {
+        bits |= (unsigned)values[i] + bias;
+    }
+    return bits & ~mask;
+}
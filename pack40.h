@@ -29,4 +29,36 @@ US_TYPE pack(quant_dct qdct);
  */
 quant_dct unpack(US_TYPE word);
 
+/* 
+ * quantized dct values of many blocks in structure-of-arrays form: block i
+ * has the values a[i], b[i], c[i], d[i], pb[i] and pr[i]
+ */
+typedef struct quant_dct_n {
+    int *a;
+    int *b;
+    int *c;
+    int *d;
+    int *pb;
+    int *pr;
+}quant_dct_n;
+
+/*
+ * pack_n
+ * Packs the values of count blocks into count 32 bit words, checking the
+ * ranges of all the values once for the whole batch
+ */
+void pack_n(quant_dct_n qdcts, int count, US_TYPE *words);
+
+/*
+ * unpack_n
+ * Unpacks count words into the values of count blocks
+ */
+void unpack_n(const US_TYPE *words, int count, quant_dct_n qdcts);
+
+/*
+ * pack_block
+ * Converts four rgb pixels of a 2x2 block straight to a 32 bit codeword
+ */
+US_TYPE pack_block(Pnm_rgb tl, Pnm_rgb tr, Pnm_rgb ll, Pnm_rgb lr, int denom);
+
 #endif
\ No newline at end of file
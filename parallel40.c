@@ -0,0 +1,114 @@
+/*
+ * parallel40.c
+ * Purpose: Split the rows of an image into horizontal bands and process the
+ *          bands on a pool of worker threads
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "assert.h"
+#include "parallel40.h"
+
+#define MAX_THREADS PARALLEL40_MAX_THREADS
+
+/* number of threads used by parallel40_map_bands */
+static int threads = 1;
+
+/* closure for a single worker thread */
+typedef struct band_cl {
+    int first_row;
+    int last_row;
+    parallel40_bandfun *band;
+    void *cl;
+}band_cl;
+
+static void *run_band(void *cl);
+
+/*
+ * parallel40_set_threads
+ * Sets the number of worker threads used by parallel40_map_bands
+ * Input: integer number of threads, must be between 1 and MAX_THREADS
+ * Output: For valid inputs, void
+ *         For invalid inputs, CRE and program exits
+ */
+void parallel40_set_threads(int num_threads)
+{
+    assert(num_threads >= 1 && num_threads <= MAX_THREADS);
+    threads = num_threads;
+}
+
+/*
+ * parallel40_threads
+ * Returns the number of worker threads used by parallel40_map_bands
+ * Input: none
+ * Output: integer number of threads
+ */
+int parallel40_threads(void)
+{
+    return threads;
+}
+
+/*
+ * parallel40_map_bands
+ * Splits rows 0 to num_rows into one band per thread and calls band on each
+ * band, returning once every band is done. The first band runs on the
+ * calling thread.
+ * Input: non-negative number of rows, function to call on each band (cannot
+ *        be null), closure passed to the band function
+ * Output: For valid inputs, void
+ *         For invalid inputs (null band function), CRE and program exits
+ */
+void parallel40_map_bands(int num_rows, parallel40_bandfun band, void *cl)
+{
+    assert(num_rows >= 0);
+    assert(band != NULL);
+
+    int num_bands = threads < num_rows ? threads : num_rows;
+    if (num_bands <= 1) {
+        band(0, num_rows, cl);
+        return;
+    }
+
+    pthread_t workers[MAX_THREADS];
+    band_cl bands[MAX_THREADS];
+
+    /* spread the leftover rows over the first bands */
+    int rows_per_band = num_rows / num_bands;
+    int leftover = num_rows % num_bands;
+    int row = 0;
+
+    for (int i = 0; i < num_bands; i++) {
+        bands[i].first_row = row;
+        row += rows_per_band + (i < leftover ? 1 : 0);
+        bands[i].last_row = row;
+        bands[i].band = band;
+        bands[i].cl = cl;
+    }
+
+    for (int i = 1; i < num_bands; i++) {
+        int err = pthread_create(&workers[i], NULL, run_band, &bands[i]);
+        assert(err == 0);
+    }
+
+    run_band(&bands[0]);
+
+    for (int i = 1; i < num_bands; i++) {
+        int err = pthread_join(workers[i], NULL);
+        assert(err == 0);
+    }
+}
+
+/*
+ * run_band
+ * Thread entry point which calls the band function on a single band
+ * Input: void pointer to the band_cl of the band (cannot be null)
+ * Output: NULL
+ */
+static void *run_band(void *cl)
+{
+    band_cl *b = cl;
+    assert(b != NULL);
+
+    b->band(b->first_row, b->last_row, b->cl);
+    return NULL;
+}
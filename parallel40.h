@@ -0,0 +1,39 @@
+/*
+ * parallel40.h
+ * Purpose: Interface to split the rows of an image into horizontal bands and
+ *          process the bands on a pool of worker threads
+ */
+#ifndef PARALLEL40_INCLUDED
+#define PARALLEL40_INCLUDED
+
+/* the most worker threads parallel40_set_threads accepts */
+#define PARALLEL40_MAX_THREADS 256
+
+/*
+ * parallel40_bandfun
+ * Work to perform on one band, covering rows first_row up to (but not
+ * including) last_row
+ */
+typedef void parallel40_bandfun(int first_row, int last_row, void *cl);
+
+/*
+ * parallel40_set_threads
+ * Sets the number of worker threads used by parallel40_map_bands, from 1 to
+ * PARALLEL40_MAX_THREADS
+ */
+void parallel40_set_threads(int num_threads);
+
+/*
+ * parallel40_threads
+ * Returns the number of worker threads used by parallel40_map_bands
+ */
+int parallel40_threads(void);
+
+/*
+ * parallel40_map_bands
+ * Splits rows 0 to num_rows into one band per thread and calls band on each
+ * band, returning once every band is done
+ */
+void parallel40_map_bands(int num_rows, parallel40_bandfun band, void *cl);
+
+#endif
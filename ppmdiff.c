@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <a2methods.h>
 #include <a2plain.h>
+#include "a2extra.h"
 #include <pnm.h>
 #include <math.h>
 
@@ -11,7 +12,16 @@ void diff_images(FILE *f1, FILE *f2);
 void check_dimensions(int larger_dimension, int smaller_dimension);
 void calculate_diff(int small_width, int small_height, Pnm_ppm image1, 
                     Pnm_ppm image2);
-double rgb_diff(Pnm_ppm image1, Pnm_ppm image2, int col, int row);
+void row_diff(int row, A2Methods_Object *first, int count, void *cl);
+
+/* closure for row_diff: the rows of image1 are compared against image2 */
+typedef struct diff_cl {
+    Pnm_ppm image1;
+    Pnm_ppm image2;
+    int small_width;
+    int small_height;
+    double sum;
+} diff_cl;
                     
 
 int main(int argc, char *argv[])
@@ -99,35 +109,36 @@ void check_dimensions(int larger_dimension, int smaller_dimension)
 void calculate_diff(int small_width, int small_height, Pnm_ppm image1, 
                     Pnm_ppm image2)
 {   
-    double rgb_difference = 0;
-    for (int i = 0; i < small_width; i++) {
-        for (int j = 0; j < small_height; j++) {
-            rgb_difference += rgb_diff(image1, image2, i, j);
-        }
-    }
-    double e_val = sqrt(rgb_difference / (3 * small_width * small_height));
+    diff_cl cl = { image1, image2, small_width, small_height, 0 };
+    uarray2_extra_plain->map_rows(image1->pixels, row_diff, &cl);
+
+    double e_val = sqrt(cl.sum / (3 * small_width * small_height));
     printf("%.4f\n", e_val);
 }
 
-double rgb_diff(Pnm_ppm image1, Pnm_ppm image2, int i, int j)
+void row_diff(int row, A2Methods_Object *first, int count, void *cl)
 {
-    Pnm_rgb pixel1 = image1->methods->at(image1->pixels, i, j);
-    Pnm_rgb pixel2 = image2->methods->at(image2->pixels, i, j);
-    
-    double image1_denom = (double) image1->denominator;
-    double image2_denom = (double) image2->denominator;
-    
-    double r = ((double) pixel1->red / image1_denom) 
-               - ((double)pixel2->red / image2_denom);
-    r *= r;
-    
-    double g = ((double) pixel1->green / image1_denom) 
-               - ((double)pixel2->green / image2_denom);
-    g *= g;
-    
-    double b = ((double) pixel1->blue / image1_denom) 
-               - ((double)pixel2->blue / image2_denom);
-    b *= b;
+    diff_cl *diff = cl;
+    (void)count;
+    if (row >= diff->small_height || diff->small_width == 0) {
+        return;
+    }
+
+    Pnm_rgb pixels1 = first;
+    Pnm_rgb pixels2 = diff->image2->methods->at(diff->image2->pixels, 0, row);
     
-    return r + g + b;
-}
\ No newline at end of file
+    double image1_denom = (double) diff->image1->denominator;
+    double image2_denom = (double) diff->image2->denominator;
+    double sum = 0;
+
+    for (int i = 0; i < diff->small_width; i++) {
+        double r = ((double) pixels1[i].red / image1_denom) 
+                   - ((double) pixels2[i].red / image2_denom);
+        double g = ((double) pixels1[i].green / image1_denom) 
+                   - ((double) pixels2[i].green / image2_denom);
+        double b = ((double) pixels1[i].blue / image1_denom) 
+                   - ((double) pixels2[i].blue / image2_denom);
+        sum += r * r + g * g + b * b;
+    }
+    diff->sum += sum;
+}
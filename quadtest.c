@@ -0,0 +1,136 @@
+/*
+ * quadtest.c
+ * Purpose: Checks the map_quads methods of the plain and blocked A2 suites:
+ *          every whole 2x2 group is visited once, and its four pointers are
+ *          the elements at gives for it. Sizes include empty, single row and
+ *          column, odd and non-square arrays, with odd and even blocksizes.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "assert.h"
+#include "a2methods.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "a2extra.h"
+
+#define RANDOM_SIZES 300
+
+/* what check_quad compares against */
+typedef struct expected {
+    A2Methods_T methods;
+    A2Methods_UArray2 array;
+    char *seen;                 /* visits of each group */
+    int visits;
+    int failures;
+}expected;
+
+void test_suite(const char *name, A2Methods_T methods, A2Extra_T extra);
+void test_size(A2Methods_T methods, A2Extra_T extra, int width, int height,
+               int blocksize);
+void check_quad(int col, int row, A2Methods_Object *tl, A2Methods_Object *tr,
+                A2Methods_Object *ll, A2Methods_Object *lr, void *cl);
+void fail(expected *exp, const char *what, int col, int row);
+
+int main()
+{
+    printf("Testing plain map_quads ...\n");
+    test_suite("plain", uarray2_methods_plain, uarray2_extra_plain);
+    printf("Testing blocked map_quads ...\n");
+    test_suite("blocked", uarray2_methods_blocked, uarray2_extra_blocked);
+    exit(EXIT_SUCCESS);
+}
+
+/*
+ * test_suite
+ * Runs test_size on fixed sizes with blocksizes 1 to 8 and 16, then on
+ * random sizes and blocksizes
+ */
+void test_suite(const char *name, A2Methods_T methods, A2Extra_T extra)
+{
+    int sizes[][2] = {
+        { 0, 0 }, { 0, 5 }, { 5, 0 }, { 1, 1 }, { 1, 9 }, { 9, 1 },
+        { 2, 2 }, { 2, 3 }, { 3, 2 }, { 3, 3 }, { 5, 7 }, { 7, 5 },
+        { 16, 9 }, { 9, 16 }, { 33, 65 }, { 100, 37 }
+    };
+    int blocksizes[] = { 1, 2, 3, 4, 5, 6, 7, 8, 16 };
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        for (size_t b = 0; b < sizeof(blocksizes) / sizeof(blocksizes[0]);
+             b++) {
+            test_size(methods, extra, sizes[i][0], sizes[i][1],
+                      blocksizes[b]);
+        }
+    }
+    for (int i = 0; i < RANDOM_SIZES; i++) {
+        test_size(methods, extra, rand() % 120, rand() % 120,
+                  rand() % 12 + 1);
+    }
+    printf("%s: map_quads matches at\n", name);
+}
+
+/*
+ * test_size
+ * Maps over the 2x2 groups of a width by height array of ints made with
+ * the given blocksize, and exits with failure if a group is missed, visited
+ * twice or has the wrong pointers
+ */
+void test_size(A2Methods_T methods, A2Extra_T extra, int width, int height,
+               int blocksize)
+{
+    expected exp = {
+        .methods = methods,
+        .array = methods->new_with_blocksize(width, height, sizeof(int),
+                                             blocksize),
+        .seen = calloc((size_t)(width / 2) * (height / 2) + 1, 1),
+    };
+    assert(exp.seen != NULL);
+
+    extra->map_quads(exp.array, check_quad, &exp);
+    if (exp.visits != (width / 2) * (height / 2)) {
+        fail(&exp, "count", width / 2, height / 2);
+    }
+
+    if (exp.failures > 0) {
+        printf("%d failures for %d x %d, blocksize %d\n", exp.failures,
+               width, height, blocksize);
+        exit(EXIT_FAILURE);
+    }
+    methods->free(&exp.array);
+    free(exp.seen);
+}
+
+/*
+ * check_quad
+ * Checks one group: it is inside the array, it was not visited before, and
+ * its four pointers are the elements at gives for it
+ */
+void check_quad(int col, int row, A2Methods_Object *tl, A2Methods_Object *tr,
+                A2Methods_Object *ll, A2Methods_Object *lr, void *cl)
+{
+    expected *exp = cl;
+    A2Methods_T methods = exp->methods;
+    A2Methods_UArray2 array = exp->array;
+    int groups_wide = methods->width(array) / 2;
+
+    exp->visits++;
+    if (col < 0 || col >= groups_wide || row < 0 ||
+        row >= methods->height(array) / 2) {
+        fail(exp, "bounds", col, row);
+        return;
+    }
+    if (tl != methods->at(array, 2 * col, 2 * row) ||
+        tr != methods->at(array, 2 * col + 1, 2 * row) ||
+        ll != methods->at(array, 2 * col, 2 * row + 1) ||
+        lr != methods->at(array, 2 * col + 1, 2 * row + 1) ||
+        exp->seen[row * groups_wide + col]++ != 0) {
+        fail(exp, "group", col, row);
+    }
+}
+
+void fail(expected *exp, const char *what, int col, int row)
+{
+    if (exp->failures++ < 10) {
+        printf("%s: %d, %d\n", what, col, row);
+    }
+}
@@ -0,0 +1,310 @@
+/*
+ * simd40.c
+ * Purpose: Vectorized kernels which compress and decompress many 2x2 blocks
+ *          of pixels at once, one block per vector lane. The kernels are
+ *          built for several instruction sets, and the best one the CPU 
+ *          supports is picked the first time a kernel is called.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "assert.h"
+#include "chroma40.h"
+#include "convert40.h"
+#include "pack40.h"
+#include "layout40.h"
+#include "simd40.h"
+#include "ypbpr40.h"
+
+/* 
+ * the kernels must round exactly like the scalar code, so multiplies and 
+ * adds may not be fused even where the instruction set has FMA; the
+ * Makefile builds this file with -ffp-contract=off for that reason
+ */
+
+#define BCD_COEFF 103
+#define A_COEFF 63
+#define MAX_BCD 0.3f
+#define MIN_BCD -0.3f
+
+#define DENOMINATOR 255
+#define BYTES_PER_BLOCK 6       /* two rgb pixels in each scanline */
+#define CHUNK_BLOCKS 256        /* blocks packed or unpacked at a time */
+
+/* environment variable which forces a kernel level, e.g. ARITH40_SIMD=avx2 */
+#define LEVEL_VARIABLE "ARITH40_SIMD"
+
+typedef void encode_rowfun(const struct Pnm_rgb *top,
+                           const struct Pnm_rgb *bottom, int num_blocks,
+                           int denom, US_TYPE *words);
+typedef void decode_rowfun(const US_TYPE *words, int num_blocks,
+                           unsigned char *top, unsigned char *bottom);
+
+/* one build of the kernels */
+typedef struct simd40_level {
+    const char *name;
+    int (*supported)(void);
+    encode_rowfun *encode_row;
+    decode_rowfun *decode_row;
+}simd40_level;
+
+static void decode_block(US_TYPE word, unsigned char *top,
+                         unsigned char *bottom);
+static void decode_quant(quant_dct qdct, unsigned char *top,
+                         unsigned char *bottom);
+static void encode_row_scalar(const struct Pnm_rgb *top,
+                              const struct Pnm_rgb *bottom, int num_blocks,
+                              int denom, US_TYPE *words);
+static void decode_row_scalar(const US_TYPE *words, int num_blocks,
+                              unsigned char *top, unsigned char *bottom);
+static void select_level(void);
+
+
+/* baseline vector kernels: SSE2 on x86-64, the native vector unit elsewhere */
+#define LANES 4
+#define KERNEL(name) name##_base
+#include "simd40_impl.h"
+#undef LANES
+#undef KERNEL
+
+#if defined(__x86_64__) || defined(__i386__)
+#define X86_LEVELS
+
+#pragma GCC push_options
+#pragma GCC target ("avx2")
+#define LANES 8
+#define KERNEL(name) name##_avx2
+#include "simd40_impl.h"
+#undef LANES
+#undef KERNEL
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target ("avx512f")
+#define LANES 16
+#define KERNEL(name) name##_avx512
+#include "simd40_impl.h"
+#undef LANES
+#undef KERNEL
+#pragma GCC pop_options
+
+static int has_avx2(void) 
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static int has_avx512(void) 
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+}
+#endif
+
+static int always(void)
+{
+    return 1;
+}
+
+/* levels from best to worst; the first supported one is used by default */
+static const simd40_level levels[] = {
+#ifdef X86_LEVELS
+    { "avx512", has_avx512, encode_row_avx512, decode_row_avx512 },
+    { "avx2", has_avx2, encode_row_avx2, decode_row_avx2 },
+    { "sse2", always, encode_row_base, decode_row_base },
+#else
+    { "vector", always, encode_row_base, decode_row_base },
+#endif
+    { "scalar", always, encode_row_scalar, decode_row_scalar },
+};
+
+static const simd40_level *level = NULL;
+static pthread_once_t level_once = PTHREAD_ONCE_INIT;
+
+/*
+ * simd40_encode_row
+ * Compresses a row of num_blocks 2x2 blocks, taken from the pixels of two
+ * scanlines, into num_blocks codewords with the selected kernel level
+ * Input: scanlines of at least 2 * num_blocks pixels for the top and bottom
+ *        of the blocks (cannot be null), number of blocks, denominator of
+ *        the image, array of num_blocks words to fill (cannot be null)
+ * Output: For valid inputs, void (words holds the codewords of the blocks)
+ *         For invalid inputs (null arrays), CRE and program exits
+ */
+void simd40_encode_row(const struct Pnm_rgb *top, const struct Pnm_rgb *bottom,
+                       int num_blocks, int denom, US_TYPE *words)
+{
+    assert(top != NULL && bottom != NULL && words != NULL);
+
+    pthread_once(&level_once, select_level);
+    level->encode_row(top, bottom, num_blocks, denom, words);
+}
+
+/*
+ * simd40_decode_row
+ * Decompresses a row of num_blocks codewords into two scanlines of
+ * interleaved 8-bit rgb samples with the selected kernel level
+ * Input: array of num_blocks codewords (cannot be null), number of blocks,
+ *        top and bottom scanlines of at least 6 * num_blocks bytes to fill
+ *        (cannot be null)
+ * Output: For valid inputs, void (top and bottom hold the decoded samples)
+ *         For invalid inputs (null arrays), CRE and program exits
+ */
+void simd40_decode_row(const US_TYPE *words, int num_blocks,
+                       unsigned char *top, unsigned char *bottom)
+{
+    assert(words != NULL && top != NULL && bottom != NULL);
+
+    pthread_once(&level_once, select_level);
+    level->decode_row(words, num_blocks, top, bottom);
+}
+
+/*
+ * simd40_level_name
+ * Returns the name of the kernel level in use
+ * Input: none
+ * Output: name of the level, e.g. "avx2"
+ */
+const char *simd40_level_name(void)
+{
+    pthread_once(&level_once, select_level);
+    return level->name;
+}
+
+/*
+ * select_level
+ * Picks the kernel level: the one named by the ARITH40_SIMD environment 
+ * variable if it is set, otherwise the best level the CPU supports
+ * Input: none
+ * Output: void (level points at the chosen level)
+ *         If ARITH40_SIMD names an unknown level or one the CPU does not 
+ *         support, prints an error and the program exits
+ */
+static void select_level(void)
+{
+    int num_levels = sizeof(levels) / sizeof(levels[0]);
+    const char *forced = getenv(LEVEL_VARIABLE);
+
+    for (int i = 0; i < num_levels; i++) {
+        if (forced == NULL && levels[i].supported()) {
+            level = &levels[i];
+            return;
+        }
+        if (forced != NULL && strcmp(forced, levels[i].name) == 0) {
+            if (!levels[i].supported()) {
+                fprintf(stderr, "%s=%s: not supported by this CPU\n",
+                        LEVEL_VARIABLE, forced);
+                exit(1);
+            }
+            level = &levels[i];
+            return;
+        }
+    }
+
+    fprintf(stderr, "%s=%s: unknown level\n", LEVEL_VARIABLE, forced);
+    exit(1);
+}
+
+/*
+ * encode_row_scalar
+ * Compresses a row of num_blocks blocks one at a time with quantize_block,
+ * packing the words a chunk of blocks at a time with pack_n
+ * Input: top and bottom scanlines of 2 * num_blocks pixels, number of
+ *        blocks, denominator of the image, array of num_blocks words to fill
+ * Output: void (words holds the codewords of the blocks)
+ */
+static void encode_row_scalar(const struct Pnm_rgb *top,
+                              const struct Pnm_rgb *bottom, int num_blocks,
+                              int denom, US_TYPE *words)
+{
+    int a[CHUNK_BLOCKS], b[CHUNK_BLOCKS], c[CHUNK_BLOCKS], d[CHUNK_BLOCKS];
+    int pb[CHUNK_BLOCKS], pr[CHUNK_BLOCKS];
+    quant_dct_n qdcts = { a, b, c, d, pb, pr };
+
+    for (int first = 0; first < num_blocks; first += CHUNK_BLOCKS) {
+        int n = num_blocks - first < CHUNK_BLOCKS ? num_blocks - first 
+                                                  : CHUNK_BLOCKS;
+
+        for (int k = 0; k < n; k++) {
+            int i = first + k;
+            quant_dct qdct = quantize_block((Pnm_rgb)&top[2 * i], 
+                                            (Pnm_rgb)&top[2 * i + 1],
+                                            (Pnm_rgb)&bottom[2 * i],
+                                            (Pnm_rgb)&bottom[2 * i + 1], 
+                                            denom);
+            a[k] = qdct.a;
+            b[k] = qdct.b;
+            c[k] = qdct.c;
+            d[k] = qdct.d;
+            pb[k] = qdct.pb;
+            pr[k] = qdct.pr;
+        }
+        pack_n(qdcts, n, &words[first]);
+    }
+}
+
+/*
+ * decode_row_scalar
+ * Decompresses a row of num_blocks codewords, unpacking them a chunk of
+ * blocks at a time with unpack_n and decoding each block with decode_quant
+ * Input: array of num_blocks codewords, top and bottom scanlines of
+ *        6 * num_blocks bytes to fill
+ * Output: void (top and bottom hold the decoded samples)
+ */
+static void decode_row_scalar(const US_TYPE *words, int num_blocks,
+                              unsigned char *top, unsigned char *bottom)
+{
+    int a[CHUNK_BLOCKS], b[CHUNK_BLOCKS], c[CHUNK_BLOCKS], d[CHUNK_BLOCKS];
+    int pb[CHUNK_BLOCKS], pr[CHUNK_BLOCKS];
+    quant_dct_n qdcts = { a, b, c, d, pb, pr };
+
+    for (int first = 0; first < num_blocks; first += CHUNK_BLOCKS) {
+        int n = num_blocks - first < CHUNK_BLOCKS ? num_blocks - first 
+                                                  : CHUNK_BLOCKS;
+        unpack_n(&words[first], n, qdcts);
+
+        for (int k = 0; k < n; k++) {
+            quant_dct qdct = { a[k], b[k], c[k], d[k], pb[k], pr[k] };
+            decode_quant(qdct, &top[BYTES_PER_BLOCK * (first + k)],
+                         &bottom[BYTES_PER_BLOCK * (first + k)]);
+        }
+    }
+}
+
+/*
+ * decode_block
+ * Decompresses one codeword into its 2x2 block with the scalar decoder
+ * Input: the codeword, top and bottom scanlines of 6 bytes to fill
+ * Output: void (top and bottom hold the decoded samples)
+ */
+static void decode_block(US_TYPE word, unsigned char *top,
+                         unsigned char *bottom)
+{
+    decode_quant(unpack(word), top, bottom);
+}
+
+/*
+ * decode_quant
+ * Decompresses the quantized dct values of one block into its 2x2 block 
+ * with dequantize, dct_to_cv and cv_to_rgb
+ * Input: the quantized values, top and bottom scanlines of 6 bytes to fill
+ * Output: void (top and bottom hold the decoded samples)
+ */
+static void decode_quant(quant_dct qdct, unsigned char *top,
+                         unsigned char *bottom)
+{
+    colorspace_block cv_block = dct_to_cv(dequantize(qdct));
+    colorspace cvs[4] = { cv_block.tl, cv_block.tr, cv_block.ll, 
+                          cv_block.lr };
+
+    for (int p = 0; p < 4; p++) {
+        unsigned char *sample = (p < 2 ? top : bottom) + 3 * (p % 2);
+        struct Pnm_rgb pixel = cv_to_rgb(cvs[p], DENOMINATOR);
+
+        sample[0] = pixel.red;
+        sample[1] = pixel.green;
+        sample[2] = pixel.blue;
+    }
+}
@@ -0,0 +1,42 @@
+/*
+ * simd40.h
+ * Purpose: Interface to vectorized kernels which compress and decompress
+ *          many 2x2 blocks of pixels at once, picking the instruction set
+ *          level at run time
+ */
+#ifndef SIMD40_INCLUDED
+#define SIMD40_INCLUDED
+
+#include <stdint.h>
+#include "pnm.h"
+
+#define US_TYPE uint64_t
+
+/*
+ * simd40_encode_row
+ * Compresses a row of num_blocks 2x2 blocks, taken from the pixels of two
+ * scanlines, into num_blocks codewords. The words are the same as those
+ * given by pack_block.
+ * Every sample must be at most denom; the callers check each scanline.
+ */
+void simd40_encode_row(const struct Pnm_rgb *top, const struct Pnm_rgb *bottom,
+                       int num_blocks, int denom, US_TYPE *words);
+
+/*
+ * simd40_decode_row
+ * Decompresses a row of num_blocks codewords into two scanlines of
+ * interleaved 8-bit rgb samples (3 bytes per pixel, 2 pixels per block).
+ * The samples are the same as those given by the scalar decoder.
+ */
+void simd40_decode_row(const US_TYPE *words, int num_blocks,
+                       unsigned char *top, unsigned char *bottom);
+
+/*
+ * simd40_level_name
+ * Returns the name of the instruction set level the kernels run at. The 
+ * best level the CPU supports is used unless the ARITH40_SIMD environment 
+ * variable names one of "avx512", "avx2", "sse2" or "scalar".
+ */
+const char *simd40_level_name(void);
+
+#endif
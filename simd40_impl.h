@@ -0,0 +1,279 @@
+/*
+ * simd40_impl.h
+ * Purpose: Body of the vectorized kernels of simd40.c. It is included once
+ *          for every instruction set the kernels are built for, so it has no
+ *          include guard. Before each inclusion LANES must be defined as the
+ *          number of blocks handled per step, and KERNEL(name) must give a
+ *          name unique to that instruction set.
+ */
+
+#define vfloat KERNEL(vfloat)
+#define vdouble KERNEL(vdouble)
+#define vint KERNEL(vint)
+#define vuint KERNEL(vuint)
+#define vabs KERNEL(vabs)
+#define vclamp KERNEL(vclamp)
+#define encode_lanes KERNEL(encode_lanes)
+#define decode_lanes KERNEL(decode_lanes)
+
+typedef float vfloat __attribute__((vector_size(LANES * sizeof(float))));
+typedef double vdouble __attribute__((vector_size(LANES * sizeof(double))));
+typedef int32_t vint __attribute__((vector_size(LANES * sizeof(int32_t))));
+typedef uint32_t vuint __attribute__((vector_size(LANES * sizeof(uint32_t))));
+
+/*
+ * vabs
+ * Returns the absolute value of every lane by clearing its sign bit
+ * Input: vector of floats
+ * Output: vector of their absolute values
+ */
+static inline vfloat vabs(vfloat x)
+{
+    return (vfloat)((vint)x & 0x7fffffff);
+}
+
+/*
+ * vclamp
+ * Limits every lane to [min, max] as check_range does, leaving NaN lanes
+ * alone
+ * Input: vector of floats, smallest and largest values allowed
+ * Output: vector of the limited values
+ */
+static inline vfloat vclamp(vfloat x, float min, float max)
+{
+    vint above = x > max;
+    vint below = x < min;
+    vint value = (vint)x;
+    value = (above & (vint)((vfloat){ 0 } + max)) | (~above & value);
+    value = (below & (vint)((vfloat){ 0 } + min)) | (~below & value);
+    return (vfloat)value;
+}
+
+/*
+ * encode_lanes
+ * Compresses LANES blocks into codewords. Every lane goes through the same
+ * table lookups and float operations, in the same order, as quantize_block,
+ * so the words are bit-for-bit the same as those of pack_block. Quantization
+ * keeps every field inside its width, so the fields are packed with plain 
+ * shifts.
+ * Input: scanlines of 2 * LANES pixels for the top and bottom of the blocks,
+ *        Y/Pb/Pr table for the denominator of the image, array of LANES 
+ *        words to fill
+ * Output: void (words holds the codewords of the blocks)
+ */
+static void encode_lanes(const struct Pnm_rgb *top,
+                         const struct Pnm_rgb *bottom, 
+                         const ypbpr_table *table, US_TYPE *words)
+{
+    vfloat y[4], pb[4], pr[4];
+
+    /* pixels are tl, tr, ll, lr as in colorspace_block */
+    for (int p = 0; p < 4; p++) {
+        const struct Pnm_rgb *line = p < 2 ? top : bottom;
+        int offset = p % 2;
+        vdouble yd, pbd, prd;
+
+        /* the colour transform comes from the table, as in rgb_to_cv */
+        for (int k = 0; k < LANES; k++) {
+            ypbpr_terms r = table->red[line[2 * k + offset].red];
+            ypbpr_terms g = table->green[line[2 * k + offset].green];
+            ypbpr_terms b = table->blue[line[2 * k + offset].blue];
+
+            yd[k] = r.y + g.y + b.y;
+            pbd[k] = r.pb + g.pb + b.pb;
+            prd[k] = r.pr + g.pr + b.pr;
+        }
+
+        y[p] = __builtin_convertvector(yd, vfloat);
+        pb[p] = __builtin_convertvector(pbd, vfloat);
+        pr[p] = __builtin_convertvector(prd, vfloat);
+    }
+
+    vfloat ave_pb = (pb[0] + pb[1] + pb[2] + pb[3]) / 4.0f;
+    vfloat ave_pr = (pr[0] + pr[1] + pr[2] + pr[3]) / 4.0f;
+
+    vfloat bcd[3];
+    bcd[0] = (y[3] + y[2] - y[1] - y[0]) / 4.0f;
+    bcd[1] = (y[3] - y[2] + y[1] - y[0]) / 4.0f;
+    bcd[2] = (y[3] - y[2] - y[1] + y[0]) / 4.0f;
+    vfloat a = (y[3] + y[2] + y[1] + y[0]) / 4.0f;
+
+    /* clamp b, c and d to [MIN_BCD, MAX_BCD] as check_range does */
+    vint q[3];
+    for (int i = 0; i < 3; i++) {
+        vfloat value = vclamp(bcd[i], MIN_BCD, MAX_BCD);
+
+        /* round_float truncates toward zero, as the conversion does */
+        q[i] = __builtin_convertvector(BCD_COEFF * value, vint);
+    }
+    vint qa = __builtin_convertvector(A_COEFF * a, vint);
+
+    /* 
+     * count the neighbouring chroma values where the upper one is strictly 
+     * nearer, as chroma40_index_of does; a true comparison is -1 
+     */
+    ave_pb = vclamp(ave_pb, -CHROMA40_LIMIT, CHROMA40_LIMIT);
+    ave_pr = vclamp(ave_pr, -CHROMA40_LIMIT, CHROMA40_LIMIT);
+    vuint qpb = { 0 };
+    vuint qpr = { 0 };
+    for (int i = 0; i < CHROMA40_COUNT - 1; i++) {
+        float below = chroma40_values[i];
+        float above = chroma40_values[i + 1];
+        qpb -= (vuint)(vabs(ave_pb - above) < vabs(ave_pb - below));
+        qpr -= (vuint)(vabs(ave_pr - above) < vabs(ave_pr - below));
+    }
+
+    vuint word = LAYOUT40_INSERT(a, (vuint)qa) |
+                 LAYOUT40_INSERT(b, (vuint)q[0]) |
+                 LAYOUT40_INSERT(c, (vuint)q[1]) |
+                 LAYOUT40_INSERT(d, (vuint)q[2]) |
+                 LAYOUT40_INSERT(pb, qpb) | LAYOUT40_INSERT(pr, qpr);
+
+    for (int k = 0; k < LANES; k++) {
+        words[k] = word[k];
+    }
+}
+
+/*
+ * decode_lanes
+ * Decompresses LANES codewords into their 2x2 blocks. Fields are extracted
+ * with shifts and masks, and every lane then goes through the same float and
+ * double operations, in the same order, as dequantize, dct_to_cv and
+ * cv_to_rgb, so the samples are bit-for-bit the same.
+ * Input: array of LANES codewords, top and bottom scanlines of
+ *        6 * LANES bytes to fill
+ * Output: void (top and bottom hold the decoded samples)
+ */
+static void decode_lanes(const US_TYPE *words, unsigned char *top,
+                         unsigned char *bottom)
+{
+    vuint word;
+    for (int k = 0; k < LANES; k++) {
+        word[k] = words[k];
+    }
+
+    vint qa = (vint)LAYOUT40_GETU(a, word);
+    vint qb = LAYOUT40_GETS(b, word, vint);
+    vint qc = LAYOUT40_GETS(c, word, vint);
+    vint qd = LAYOUT40_GETS(d, word, vint);
+    vuint qpb = LAYOUT40_GETU(pb, word);
+    vuint qpr = LAYOUT40_GETU(pr, word);
+
+    /* 
+     * pb and pr fields wider than 4 bits can hold values which are not 
+     * chroma indices; reject them as chroma40_of_index does (a constant 
+     * false for 4-bit fields)
+     */
+    vfloat pb, pr;
+    for (int k = 0; k < LANES; k++) {
+        if (LAYOUT40_MASK_pb >= CHROMA40_COUNT || 
+            LAYOUT40_MASK_pr >= CHROMA40_COUNT) {
+            assert(qpb[k] < CHROMA40_COUNT && qpr[k] < CHROMA40_COUNT);
+        }
+        pb[k] = chroma40_values[qpb[k]];
+        pr[k] = chroma40_values[qpr[k]];
+    }
+
+    vfloat a = __builtin_convertvector(qa, vfloat) / A_COEFF;
+    vfloat b = __builtin_convertvector(qb, vfloat) / BCD_COEFF;
+    vfloat c = __builtin_convertvector(qc, vfloat) / BCD_COEFF;
+    vfloat d = __builtin_convertvector(qd, vfloat) / BCD_COEFF;
+
+    /* pixels are tl, tr, ll, lr as in colorspace_block */
+    vfloat y[4];
+    y[0] = a - b - c + d;
+    y[1] = a - b + c - d;
+    y[2] = a + b - c - d;
+    y[3] = a + b + c + d;
+
+    vdouble pbd = __builtin_convertvector(pb, vdouble);
+    vdouble prd = __builtin_convertvector(pr, vdouble);
+
+    for (int p = 0; p < 4; p++) {
+        vdouble yd = __builtin_convertvector(y[p], vdouble);
+
+        /* the colour transform is done in double, as in cv_to_rgb */
+        vfloat rgb[3];
+        rgb[0] = __builtin_convertvector(1.0 * yd + 0.0 * pbd + 1.402 * prd,
+                                         vfloat);
+        rgb[1] = __builtin_convertvector(1.0 * yd - 0.344136 * pbd - 
+                                         0.714136 * prd, vfloat);
+        rgb[2] = __builtin_convertvector(1.0 * yd + 1.772 * pbd + 0.0 * prd,
+                                         vfloat);
+
+        unsigned char *line = p < 2 ? top : bottom;
+        int offset = 3 * (p % 2);
+
+        for (int i = 0; i < 3; i++) {
+            /* round_float truncates toward zero, as the conversion does */
+            vint value = __builtin_convertvector(rgb[i] * DENOMINATOR, vint);
+            vint above = value > DENOMINATOR;
+            vint below = value < 0;
+            value = (above & DENOMINATOR) | (~above & value);
+            value = ~below & value;
+
+            for (int k = 0; k < LANES; k++) {
+                line[BYTES_PER_BLOCK * k + offset + i] = value[k];
+            }
+        }
+    }
+}
+
+/*
+ * encode_row
+ * Compresses a row of num_blocks blocks LANES at a time, sending any
+ * leftover blocks through pack_block
+ * Input: top and bottom scanlines of 2 * num_blocks pixels, number of
+ *        blocks, denominator of the image, array of num_blocks words to fill
+ * Output: void (words holds the codewords of the blocks)
+ */
+static void KERNEL(encode_row)(const struct Pnm_rgb *top,
+                               const struct Pnm_rgb *bottom, int num_blocks,
+                               int denom, US_TYPE *words)
+{
+    const ypbpr_table *table = ypbpr40_table(denom);
+    int i = 0;
+
+    for (; i + LANES <= num_blocks; i += LANES) {
+        encode_lanes(&top[2 * i], &bottom[2 * i], table, &words[i]);
+    }
+
+    for (; i < num_blocks; i++) {
+        words[i] = pack_block((Pnm_rgb)&top[2 * i], (Pnm_rgb)&top[2 * i + 1],
+                              (Pnm_rgb)&bottom[2 * i],
+                              (Pnm_rgb)&bottom[2 * i + 1], denom);
+    }
+}
+
+/*
+ * decode_row
+ * Decompresses a row of num_blocks codewords LANES at a time, sending any
+ * leftover words through decode_block
+ * Input: array of num_blocks codewords, top and bottom scanlines of
+ *        6 * num_blocks bytes to fill
+ * Output: void (top and bottom hold the decoded samples)
+ */
+static void KERNEL(decode_row)(const US_TYPE *words, int num_blocks,
+                               unsigned char *top, unsigned char *bottom)
+{
+    int i = 0;
+
+    for (; i + LANES <= num_blocks; i += LANES) {
+        decode_lanes(&words[i], &top[BYTES_PER_BLOCK * i],
+                     &bottom[BYTES_PER_BLOCK * i]);
+    }
+
+    for (; i < num_blocks; i++) {
+        decode_block(words[i], &top[BYTES_PER_BLOCK * i],
+                     &bottom[BYTES_PER_BLOCK * i]);
+    }
+}
+
+#undef vfloat
+#undef vdouble
+#undef vint
+#undef vuint
+#undef vabs
+#undef vclamp
+#undef encode_lanes
+#undef decode_lanes
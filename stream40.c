@@ -0,0 +1,247 @@
+/*
+ * stream40.c
+ * Purpose: Compress and decompress images two scanlines at a time, so memory
+ *          use grows with the width of the image but not its height
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "assert.h"
+#include "pnm.h"
+#include "fixed40.h"
+#include "simd40.h"
+#include "stream40.h"
+#include "words40.h"
+
+#define BYTE_SIZE 8
+#define MAX_SAMPLE 65535
+#define BSIZE 2
+#define DENOMINATOR 255
+
+/* widest image streamed; keeps each scanline buffer to a few hundred MB */
+#define MAX_WIDTH (1u << 24)
+
+/* what we know about an image after reading its PPM header */
+typedef struct ppm_header {
+    unsigned width;
+    unsigned height;
+    unsigned denominator;
+    int raw;                 /* 1 for binary P6, 0 for plain text P3 */
+}ppm_header;
+
+static ppm_header read_header(FILE *fp);
+static unsigned read_header_value(FILE *fp);
+static void read_scanline(FILE *fp, ppm_header header, unsigned char *raw,
+                          struct Pnm_rgb *line);
+
+/*
+ * stream_compress40
+ * Reads a PPM image from fp one pair of scanlines at a time and writes the
+ * codewords for each row of blocks to standard output as soon as they are
+ * ready, trimming odd widths and heights the same way compress40 does
+ * Input: File stream pointer which contains the decompressed image (cannot
+ *        be null)
+ * Output: For valid inputs, void (compressed image written to stdout)
+ *         For invalid inputs (null file, bad header, image smaller than 2x2
+ *         or wider than MAX_WIDTH, file too short), CRE and program exits
+ */
+void stream_compress40(FILE *fp)
+{
+    assert(fp != NULL);
+
+    ppm_header header = read_header(fp);
+    assert(header.width >= 2 && header.height >= 2);
+    assert(header.width <= MAX_WIDTH);
+
+    unsigned width = header.width - header.width % 2;
+    unsigned height = header.height - header.height % 2;
+
+    /* a raw scanline holds up to 2 bytes per sample */
+    unsigned char *raw = malloc((size_t)header.width * 3 * 2);
+    struct Pnm_rgb *top = malloc(header.width * sizeof(*top));
+    struct Pnm_rgb *bottom = malloc(header.width * sizeof(*bottom));
+    US_TYPE *words = malloc(width / BSIZE * sizeof(*words));
+    assert(raw != NULL && top != NULL && bottom != NULL && words != NULL);
+
+    printf("COMP40 Compressed image format 2\n%u %u\n", width, height);
+
+    for (unsigned row = 0; row < height; row += BSIZE) {
+        read_scanline(fp, header, raw, top);
+        read_scanline(fp, header, raw, bottom);
+
+        if (fixed40_enabled()) {
+            fixed40_encode_row(top, bottom, width / BSIZE, 
+                               header.denominator, words);
+        } else {
+            simd40_encode_row(top, bottom, width / BSIZE, 
+                              header.denominator, words);
+        }
+        words40_write(stdout, words, width / BSIZE);
+    }
+
+    free(words);
+    free(raw);
+    free(top);
+    free(bottom);
+}
+
+/*
+ * stream_decompress40
+ * Reads a compressed image from fp one row of codewords at a time and writes
+ * the two scanlines for each row to standard output as soon as they are
+ * decoded
+ * Input: File stream pointer which contains the compressed image (cannot be
+ *        null)
+ * Output: For valid inputs, void (decompressed image written to stdout)
+ *         For invalid inputs (null file, bad header, image wider than 
+ *         MAX_WIDTH, file too short or with bytes after the last 
+ *         codeword), CRE and program exits
+ */
+void stream_decompress40(FILE *fp)
+{
+    assert(fp != NULL);
+
+    unsigned height, width;
+    int read = fscanf(fp, "COMP40 Compressed image format 2\n%u %u", 
+                      &width, &height);
+    assert(read == 2);
+    int c = getc(fp);
+    assert(c == '\n');
+    assert(width % 2 == 0 && height % 2 == 0);
+    assert(width <= MAX_WIDTH);
+
+    /* two scanlines of 3 bytes per pixel */
+    unsigned char *top = malloc((size_t)width * 3);
+    unsigned char *bottom = malloc((size_t)width * 3);
+    US_TYPE *words = malloc(width / BSIZE * sizeof(*words));
+    assert(width == 0 || (top != NULL && bottom != NULL && words != NULL));
+
+    printf("P6\n%u %u\n%u\n", width, height, DENOMINATOR);
+
+    for (unsigned row = 0; row < height; row += BSIZE) {
+        words40_read(fp, words, width / BSIZE);
+        if (fixed40_enabled()) {
+            fixed40_decode_row(words, width / BSIZE, top, bottom);
+        } else {
+            simd40_decode_row(words, width / BSIZE, top, bottom);
+        }
+
+        size_t written = fwrite(top, 3, width, stdout);
+        written += fwrite(bottom, 3, width, stdout);
+        assert(written == 2 * width);
+    }
+
+    /* as in words40_load, nothing may follow the last codeword */
+    c = getc(fp);
+    assert(c == EOF);
+
+    free(words);
+    free(top);
+    free(bottom);
+}
+
+/*
+ * read_header
+ * Reads the magic number, width, height and maxval of a PPM image, leaving
+ * fp at the first sample of the image
+ * Input: File stream pointer (cannot be null)
+ * Output: For valid inputs, a ppm_header describing the image
+ *         For invalid inputs (not a P3 or P6 image, bad maxval), CRE and
+ *         program exits
+ */
+static ppm_header read_header(FILE *fp)
+{
+    assert(fp != NULL);
+
+    ppm_header header;
+
+    int p = getc(fp);
+    int kind = getc(fp);
+    assert(p == 'P' && (kind == '6' || kind == '3'));
+    header.raw = (kind == '6');
+
+    header.width = read_header_value(fp);
+    header.height = read_header_value(fp);
+    header.denominator = read_header_value(fp);
+    assert(header.denominator > 0 && header.denominator <= MAX_SAMPLE);
+
+    /* exactly one whitespace character separates maxval from the pixels */
+    int c = getc(fp);
+    assert(c != EOF && isspace(c));
+
+    return header;
+}
+
+/*
+ * read_header_value
+ * Skips whitespace and comments, then reads one unsigned header value
+ * Input: File stream pointer (cannot be null)
+ * Output: For valid inputs, the value read
+ *         For invalid inputs (missing value), CRE and program exits
+ */
+static unsigned read_header_value(FILE *fp)
+{
+    int c = getc(fp);
+
+    while (isspace(c) || c == '#') {
+        if (c == '#') {
+            while (c != '\n' && c != EOF) {
+                c = getc(fp);
+            }
+        }
+        c = getc(fp);
+    }
+    assert(c != EOF && isdigit(c));
+
+    unsigned value = 0;
+    while (c != EOF && isdigit(c)) {
+        value = value * 10 + (c - '0');
+        c = getc(fp);
+    }
+    ungetc(c, fp);
+
+    return value;
+}
+
+/*
+ * read_scanline
+ * Reads the next full scanline of the image into line
+ * Input: File stream pointer (cannot be null), header of the image, scratch
+ *        buffer large enough for one raw scanline, array of header.width
+ *        pixels to fill
+ * Output: For valid inputs, void (line holds the pixels of the scanline)
+ *         For invalid inputs (file too short, sample above the maxval), CRE
+ *         and program exits
+ */
+static void read_scanline(FILE *fp, ppm_header header, unsigned char *raw,
+                          struct Pnm_rgb *line)
+{
+    size_t samples = (size_t)header.width * 3;
+    unsigned values[3];
+
+    int bytes_per_sample = header.denominator > 255 ? 2 : 1;
+    if (header.raw) {
+        size_t read = fread(raw, bytes_per_sample, samples, fp);
+        assert(read == samples);
+    }
+
+    for (unsigned col = 0; col < header.width; col++) {
+        for (unsigned i = 0; i < 3; i++) {
+            size_t sample = (size_t)col * 3 + i;
+            if (!header.raw) {
+                int read = fscanf(fp, "%u", &values[i]);
+                assert(read == 1);
+            } else if (bytes_per_sample == 1) {
+                values[i] = raw[sample];
+            } else {
+                values[i] = (raw[2 * sample] << BYTE_SIZE) | 
+                            raw[2 * sample + 1];
+            }
+            assert(values[i] <= header.denominator);
+        }
+        line[col].red = values[0];
+        line[col].green = values[1];
+        line[col].blue = values[2];
+    }
+}
@@ -0,0 +1,28 @@
+/*
+ * stream40.h
+ * Purpose: Interface to compress and decompress images two scanlines at a
+ *          time, so memory use grows with the width of the image but not its
+ *          height
+ */
+#ifndef STREAM40_INCLUDED
+#define STREAM40_INCLUDED
+
+#include <stdio.h>
+
+/*
+ * stream_compress40
+ * Reads a PPM image from fp one pair of scanlines at a time and writes the
+ * codewords for each row of blocks to standard output as soon as they are
+ * ready. The output is identical to that of compress40.
+ */
+void stream_compress40(FILE *fp);
+
+/*
+ * stream_decompress40
+ * Reads a compressed image from fp one row of codewords at a time and writes
+ * the two scanlines for each row to standard output as soon as they are
+ * decoded. The output is identical to that of decompress40.
+ */
+void stream_decompress40(FILE *fp);
+
+#endif
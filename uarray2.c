@@ -1,5 +1,6 @@
 
 #include "uarray2.h"
+#include "uarray2_rows.h"
 #include "uarray.h"
 #include "mem.h"
 #include <stdlib.h>
@@ -93,3 +94,27 @@ extern void UArray2_map_col_major
         apply(col, row, uarray2, UArray2_at(uarray2, col, row), cl);
     }
 }
+
+
+/*
+ * UArray2_map_rows
+ * Calls apply once per row with a pointer to the row's first element and the
+ * number of elements in the row. Rows are stored contiguously, so the
+ * callback can walk them with plain pointer arithmetic.
+ * Input: the array (cannot be null), function to apply to each row
+ *        (cannot be null), closure
+ * Output: For valid inputs, void
+ *         For invalid inputs (null array or function), CRE and program exits
+ */
+extern void UArray2_map_rows(T uarray2, UArray2_applyrowfun apply, void *cl)
+{
+    assert(uarray2 != NULL && apply != NULL);
+    if (uarray2->width == 0 || uarray2->height == 0) {
+        return;
+    }
+    char *first = UArray_at(uarray2->elems, 0);
+    size_t row_bytes = (size_t)uarray2->width * uarray2->size;
+    for (int row = 0; row < uarray2->height; row++) {
+        apply(row, first + row * row_bytes, uarray2->width, cl);
+    }
+}
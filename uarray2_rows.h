@@ -0,0 +1,26 @@
+/*
+ * uarray2_rows.h
+ * Purpose: Extension to the UArray2 interface which hands callers each row
+ *          of the array as one contiguous span of elements, instead of one
+ *          element at a time through UArray2_at
+ */
+#ifndef UARRAY2_ROWS_INCLUDED
+#define UARRAY2_ROWS_INCLUDED
+
+#include "uarray2.h"
+
+/*
+ * UArray2_applyrowfun
+ * Work to perform on one row: first points at the element in column 0, and
+ * the count elements of the row follow it contiguously
+ */
+typedef void UArray2_applyrowfun(int row, void *first, int count, void *cl);
+
+/*
+ * UArray2_map_rows
+ * Calls apply once for each row of the array, from row 0 down
+ */
+extern void UArray2_map_rows(UArray2_T uarray2, UArray2_applyrowfun apply,
+                             void *cl);
+
+#endif
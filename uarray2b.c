@@ -1,83 +1,90 @@
-#line 59 "www/solutions/uarray2b.nw"
+/*
+ * uarray2b.c
+ * Purpose: Blocked 2D arrays. Tangled from www/solutions/uarray2b.nw at
+ *          first, and edited here since, so it no longer carries #line
+ *          references into that file.
+ */
+
 #include <math.h>
+#include <stdint.h>
 #include "assert.h"
 #include "mem.h"
-#include "uarray.h"
-#include "uarray2.h"
 #include "uarray2b.h"
+#include "uarray2b_pow2.h"
+#include "uarray2b_quads.h"
 
 #define T UArray2b_T
 
+#define CELLS_ALIGN 64          /* cells start on a cache line */
+
 struct T { /* represents a 2D array of cells each of size 'size' */
         int width, height;
         unsigned blocksize;
         unsigned size;
-        UArray2_T blocks;
+        int shift;      /* log2 of blocksize if it is a power of two, or -1 */
+        int xblocks, yblocks;
+        size_t block_bytes;
+        char *cells;
+        void *storage;
         /*
          * matrix of blocks, each blocksize * blocksize 
          *
-         * matrix dimensions are width and height divided by blocksize,
-         * rounded up
+         * matrix dimensions (xblocks by yblocks) are width and height 
+         * divided by blocksize, rounded up
          *
-         * a block is a Uarray_T of length blocksize * blocksize 
-         * and size 'size'
+         * all blocks live in one allocation, storage, of which cells is
+         * the first aligned byte.  Block (bx, by) is the block_bytes 
+         * starting at cells + (bx * yblocks + by) * block_bytes, so 
+         * UArray2b_map walks memory in order.  Within a block, cells are 
+         * column-major, as before.
+         *
+         * when blocksize is a power of two, UArray2b_at finds the block and
+         * the cell with shifts and masks instead of divisions
          *
          * invariant relating cells in blocks to cells in the abstraction
          *  described in section on coordinate transformations below
          */
 };
-#line 94 "www/solutions/uarray2b.nw"
 #include <stdio.h>  /* include so we can print diagnostics */
 
 T UArray2b_new(int width, int height, int size, int blocksize)
 {
         assert(blocksize > 0);
+        assert(width >= 0 && height >= 0 && size > 0);
         T array;
         NEW(array);
         array->width  = width;
         array->height = height;
         array->size   = size;
         array->blocksize = blocksize;
-        array->blocks = UArray2_new((width  + blocksize - 1) / blocksize,
-                                    (height + blocksize - 1) / blocksize,
-                                    sizeof(UArray_T));
-        int xblocks = UArray2_width (array->blocks); 
-        int yblocks = UArray2_height(array->blocks);
-        for (int i = 0; i < xblocks; i++) {
-                for (int j = 0; j < yblocks; j++) {
-                        UArray_T *block = UArray2_at(array->blocks, i, j);
-                        *block = UArray_new(blocksize * blocksize, size);
-                        
-#line 169 "www/solutions/uarray2b.nw"
-if (0) {
-        fprintf(stderr, "Allocated %p; put %p at %p\n",
-                (void *)*block, (void *)*(UArray_T*)UArray2_at(array->blocks, i, j),
-                UArray2_at(array->blocks, i, j));
-}
-#line 115 "www/solutions/uarray2b.nw"
-                                  }
+        array->shift = -1;
+        if ((blocksize & (blocksize - 1)) == 0) {
+                array->shift = __builtin_ctz(blocksize);
+        }
+        array->xblocks = (width  + blocksize - 1) / blocksize;
+        array->yblocks = (height + blocksize - 1) / blocksize;
+        array->block_bytes = (size_t)blocksize * blocksize * size;
+
+        /* one zeroed allocation for every block, like UArray_new's */
+        size_t bytes = (size_t)array->xblocks * array->yblocks * 
+                       array->block_bytes;
+        array->storage = CALLOC(1, bytes + CELLS_ALIGN - 1);
+        assert(array->storage != NULL);
+        array->cells = (char *)(((uintptr_t)array->storage + CELLS_ALIGN - 1)
+                                & ~(uintptr_t)(CELLS_ALIGN - 1));
+        
+        if (0) {
+                fprintf(stderr, "Allocated %p for %d x %d blocks\n",
+                        array->storage, array->xblocks, array->yblocks);
         }
         return array;
 }
-#line 124 "www/solutions/uarray2b.nw"
 void UArray2b_free(T *array2b)
 {
-        int i;
         assert(array2b && *array2b);
-        T array = *array2b;
-        int xblocks = UArray2_width (array->blocks);
-        int yblocks = UArray2_height(array->blocks);
-        assert(UArray2_size(array->blocks) == sizeof(UArray_T));
-        for (i = 0; i < xblocks; i++) {
-                for (int j = 0; j < yblocks; j++) {
-                        UArray_T *p = UArray2_at(array->blocks, i, j);
-                        UArray_free(p);
-                }
-        }
-        UArray2_free(&(*array2b)->blocks);
+        FREE((*array2b)->storage);
         FREE(*array2b);
 }
-#line 148 "www/solutions/uarray2b.nw"
 T UArray2b_new_64K_block(int width, int height, int size)
 {
         int blocksize = (int) floor(sqrt((double) (64 * 1024)
@@ -92,19 +99,39 @@ T UArray2b_new_64K_block(int width, int height, int size)
         }
         return UArray2b_new(width, height, size, blocksize);
 }
-#line 200 "www/solutions/uarray2b.nw"
+
+T UArray2b_new_64K_pow2_block(int width, int height, int size)
+{
+        assert(size > 0);
+        /* the largest power of two whose block fits in 64KB, at least 1 */
+        int blocksize = 1;
+        while ((long)(2 * blocksize) * (2 * blocksize) * size <= 64 * 1024) {
+                blocksize *= 2;
+        }
+        return UArray2b_new(width, height, size, blocksize);
+}
 void *UArray2b_at(T array2b, int i, int j)
 {
         assert(i >= 0 && j >= 0);
         /* avoid unused cells */
         assert(i < array2b->width && j < array2b->height);
-        int b  = array2b->blocksize;
-        int bx = i / b;   /* block x coordinate */
-        int by = j / b;   /* block y coordinate */
-        UArray_T *blockp = UArray2_at(array2b->blocks, bx, by);
-        return UArray_at(*blockp, (i % b) * b + j % b);
+        int b     = array2b->blocksize;
+        int shift = array2b->shift;
+        int bx, by, cell;
+        if (shift >= 0) {
+                int mask = b - 1;
+                bx   = i >> shift;
+                by   = j >> shift;
+                cell = ((i & mask) << shift) | (j & mask);
+        } else {
+                bx   = i / b;   /* block x coordinate */
+                by   = j / b;   /* block y coordinate */
+                cell = (i % b) * b + j % b;
+        }
+        size_t block = (size_t)bx * array2b->yblocks + by;
+        return array2b->cells + block * array2b->block_bytes
+                              + (size_t)cell * array2b->size;
 }
-#line 222 "www/solutions/uarray2b.nw"
 void UArray2b_map(T array2b, 
                   void apply(int col, int row, T array2b,
                              void *elem, void *cl),
@@ -114,32 +141,85 @@ void UArray2b_map(T array2b,
         int       h      = array2b->height;
         int       w      = array2b->width;
         int       b      = array2b->blocksize;
-        UArray2_T blocks = array2b->blocks;
-        int       bw     = UArray2_width(blocks);
-        int       bh     = UArray2_height(blocks);
+        int       bw     = array2b->xblocks;
+        int       bh     = array2b->yblocks;
+        int       size   = array2b->size;
+        char     *block  = array2b->cells;
 
         for (int bx = 0; bx < bw; bx++) {
-                for (int by = 0; by < bh; by++) {
-                        UArray_T *blockp = UArray2_at(blocks, bx, by);
-                        UArray_T  block  = *blockp;
-                        int       len    = UArray_length(block);
+                for (int by = 0; by < bh; by++, 
+                     block += array2b->block_bytes) {
                         /* (i0, j0) correspond to upper left */
                         /* corner of block (bx, by)          */
                         int i0 = b * bx; 
                         int j0 = b * by; 
-                        for (int cell = 0; cell < len; cell++) {
-                                int i = i0 + cell / b;
-                                int j = j0 + cell % b;
-                                /* measured overhead 0.5% to 1.5% */
-                                if (i < w && j < h) {
-                                        apply(i, j, array2b, 
-                                              UArray_at(block, cell), cl);
+                        /* 
+                         * interior blocks are full; the blocks on the right
+                         * and bottom edges are cut to the cells in use, so
+                         * no cell needs a division or a bounds check
+                         */
+                        int iw = w - i0 < b ? w - i0 : b;
+                        int jh = h - j0 < b ? h - j0 : b;
+                        for (int di = 0; di < iw; di++) {
+                                char *col = block + (size_t)di * b * size;
+                                for (int dj = 0; dj < jh; dj++) {
+                                        apply(i0 + di, j0 + dj, array2b,
+                                              col + (size_t)dj * size, cl);
+                                }
+                        }
+                }
+        }
+}
+
+void UArray2b_map_quads(T array2b, UArray2b_quadfun apply, void *cl)
+{
+        assert(array2b && apply);
+        int       qw     = array2b->width  / 2;  /* quads across */
+        int       qh     = array2b->height / 2;  /* quads down */
+        int       b      = array2b->blocksize;
+        size_t    size   = array2b->size;
+
+        if (b % 2 != 0) {
+                /* quads straddle blocks, so find each cell on its own */
+                for (int qi = 0; qi < qw; qi++) {
+                        for (int qj = 0; qj < qh; qj++) {
+                                int i = 2 * qi, j = 2 * qj;
+                                apply(qi, qj, 
+                                      UArray2b_at(array2b, i, j),
+                                      UArray2b_at(array2b, i + 1, j),
+                                      UArray2b_at(array2b, i, j + 1),
+                                      UArray2b_at(array2b, i + 1, j + 1),
+                                      cl);
+                        }
+                }
+                return;
+        }
+
+        /* 
+         * with an even blocksize every quad lies inside one block; cells are
+         * column-major there, so the cell below is the next one and the cell
+         * to the right is a column of b cells further on
+         */
+        char *block = array2b->cells;
+        for (int bx = 0; bx < array2b->xblocks; bx++) {
+                for (int by = 0; by < array2b->yblocks; by++,
+                     block += array2b->block_bytes) {
+                        int q0 = bx * b / 2;
+                        int r0 = by * b / 2;
+                        int iw = qw - q0 < b / 2 ? qw - q0 : b / 2;
+                        int jh = qh - r0 < b / 2 ? qh - r0 : b / 2;
+                        for (int di = 0; di < iw; di++) {
+                                char *col = block + 2 * di * b * size;
+                                for (int dj = 0; dj < jh; dj++) {
+                                        char *tl = col + 2 * dj * size;
+                                        apply(q0 + di, r0 + dj, tl, 
+                                              tl + b * size, tl + size, 
+                                              tl + (b + 1) * size, cl);
                                 }
                         }
                 }
         }
 }
-#line 269 "www/solutions/uarray2b.nw"
 int UArray2b_height(T array2b)
 {
         assert(array2b);
@@ -161,5 +241,4 @@ int UArray2b_blocksize(T array2b)
 {
         assert(array2b);
         return array2b->blocksize;
-}
-#line 296 "www/solutions/uarray2b.nw"
\ No newline at end of file
+}
\ No newline at end of file
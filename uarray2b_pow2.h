@@ -0,0 +1,20 @@
+/*
+ * uarray2b_pow2.h
+ * Purpose: Extension to the UArray2b interface which creates blocked arrays
+ *          whose blocksize is a power of two, so that UArray2b_at can find
+ *          cells with shifts and masks instead of divisions
+ */
+#ifndef UARRAY2B_POW2_INCLUDED
+#define UARRAY2B_POW2_INCLUDED
+
+#include "uarray2b.h"
+
+/*
+ * UArray2b_new_64K_pow2_block
+ * Like UArray2b_new_64K_block, but the blocksize is the largest power of
+ * two whose block fits in 64KB (1 if a single cell is bigger than that)
+ */
+extern UArray2b_T UArray2b_new_64K_pow2_block(int width, int height, 
+                                              int size);
+
+#endif
@@ -0,0 +1,28 @@
+/*
+ * uarray2b_quads.h
+ * Purpose: Extension to the UArray2b interface which visits the array one
+ *          2x2 group of cells at a time, instead of one cell at a time
+ */
+#ifndef UARRAY2B_QUADS_INCLUDED
+#define UARRAY2B_QUADS_INCLUDED
+
+#include "uarray2b.h"
+
+/*
+ * UArray2b_quadfun
+ * Work to perform on the 2x2 group of cells whose top left cell is at 
+ * column 2 * col, row 2 * row
+ */
+typedef void UArray2b_quadfun(int col, int row, void *tl, void *tr, 
+                              void *ll, void *lr, void *cl);
+
+/*
+ * UArray2b_map_quads
+ * Calls apply once for each 2x2 group of cells; a last column or row of odd
+ * width or height is not visited. With an even blocksize, groups are 
+ * visited in block order, as UArray2b_map visits cells.
+ */
+extern void UArray2b_map_quads(UArray2b_T array2b, UArray2b_quadfun apply,
+                               void *cl);
+
+#endif
@@ -0,0 +1,369 @@
+/*
+ * uarray2m.c
+ * Purpose: Two-dimensional array stored in Morton (Z-order). The index of a
+ *          cell interleaves the bits of its column (even bits) and row (odd
+ *          bits), so each aligned 2^k by 2^k square of cells is contiguous.
+ *          Indexes are computed with PDEP where the CPU has a fast one,
+ *          which is checked when an array is created, and by spreading bits
+ *          with shifts and masks elsewhere.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "assert.h"
+#include "mem.h"
+#include "uarray2m.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define PDEP_LEVEL
+#endif
+
+#define T UArray2m_T
+
+/*
+ * The array is padded to a power of two in each dimension. It is stored as
+ * a line of squares of side cells (the smaller padded dimension), each in
+ * Z-order, and the squares run along the larger dimension. Cells in the
+ * padding are never visited, so calloc'd pages holding only padding are
+ * never touched.
+ */
+struct T {
+    int width;
+    int height;
+    int size;
+    int shift;                  /* log2 of side */
+    unsigned side;
+    bool pdep;                  /* whether indexes are computed with PDEP */
+    char *cells;
+};
+
+static unsigned pow2_at_least(int n);
+static bool has_fast_pdep(void);
+static inline uint64_t morton(uint32_t col, uint32_t row);
+static inline uint64_t spread_bits(uint32_t bits);
+#ifdef PDEP_LEVEL
+static uint64_t morton_pdep(uint32_t col, uint32_t row);
+#endif
+static void map_square(T array2m, int col, int row, unsigned side,
+                       char *first,
+                       void apply(int col, int row, T array2m, void *elem,
+                                  void *cl),
+                       void *cl);
+static void map_quads_square(T array2m, int col, int row, unsigned side,
+                             char *first, UArray2m_quadfun apply, void *cl);
+
+/*
+ * UArray2m_new
+ * Creates a width by height array of zeroed cells of size bytes
+ * Input: non-negative width and height, positive size
+ * Output: For valid inputs, the new array
+ *         For invalid inputs (negative dimensions, size of 0 or less, out of
+ *         memory), CRE and program exits
+ */
+extern T UArray2m_new(int width, int height, int size)
+{
+    assert(width >= 0 && height >= 0 && size > 0);
+    T array2m;
+    NEW(array2m);
+    assert(array2m != NULL);
+
+    unsigned padded_width = pow2_at_least(width);
+    unsigned padded_height = pow2_at_least(height);
+
+    array2m->width = width;
+    array2m->height = height;
+    array2m->size = size;
+    array2m->side = padded_width < padded_height ? padded_width
+                                                 : padded_height;
+    array2m->shift = __builtin_ctz(array2m->side);
+    array2m->pdep = has_fast_pdep();
+
+    /* large blocks are mmap'd, so untouched padding costs no memory */
+    array2m->cells = CALLOC((size_t)padded_width * padded_height, size);
+    assert(array2m->cells != NULL);
+    return array2m;
+}
+
+/*
+ * UArray2m_free
+ * Frees an array and sets it to null
+ * Input: pointer to the array (neither can be null)
+ * Output: For valid inputs, void
+ *         For invalid inputs (null pointers), CRE and program exits
+ */
+extern void UArray2m_free(T *array2m)
+{
+    assert(array2m != NULL && *array2m != NULL);
+    FREE((*array2m)->cells);
+    FREE(*array2m);
+}
+
+extern int UArray2m_width(T array2m)
+{
+    assert(array2m != NULL);
+    return array2m->width;
+}
+
+extern int UArray2m_height(T array2m)
+{
+    assert(array2m != NULL);
+    return array2m->height;
+}
+
+extern int UArray2m_size(T array2m)
+{
+    assert(array2m != NULL);
+    return array2m->size;
+}
+
+/*
+ * UArray2m_at
+ * Returns a pointer to the cell at column col, row row. The low bits of
+ * col and row pick the cell within its square, and the high bits of the
+ * larger dimension pick the square.
+ * Input: the array (cannot be null), column and row inside the array
+ * Output: For valid inputs, pointer to the cell
+ *         For invalid inputs (null array, out of bounds), CRE and program
+ *         exits
+ */
+extern void *UArray2m_at(T array2m, int col, int row)
+{
+    assert(array2m != NULL);
+    assert(col >= 0 && col < array2m->width);
+    assert(row >= 0 && row < array2m->height);
+
+    unsigned mask = array2m->side - 1;
+    uint64_t square = (unsigned)(col | row) >> array2m->shift;
+    uint64_t cell;
+#ifdef PDEP_LEVEL
+    if (array2m->pdep) {
+        cell = morton_pdep(col & mask, row & mask);
+    } else
+#endif
+    {
+        cell = morton(col & mask, row & mask);
+    }
+    uint64_t index = cell | square << (2 * array2m->shift);
+    return array2m->cells + index * array2m->size;
+}
+
+/*
+ * UArray2m_map
+ * Calls apply on every cell in Z-order by splitting each square into
+ * quarters, skipping quarters which lie wholly in the padding
+ * Input: the array (cannot be null), function to apply (cannot be null),
+ *        closure
+ * Output: For valid inputs, void
+ *         For invalid inputs (null array or function), CRE and program exits
+ */
+extern void UArray2m_map(T array2m,
+                         void apply(int col, int row, T array2m,
+                                    void *elem, void *cl),
+                         void *cl)
+{
+    assert(array2m != NULL && apply != NULL);
+    unsigned side = array2m->side;
+    size_t square_bytes = (size_t)side * side * array2m->size;
+    char *first = array2m->cells;
+
+    /* the squares run along whichever dimension is larger */
+    if (array2m->width > array2m->height) {
+        for (int col = 0; col < array2m->width; col += side) {
+            map_square(array2m, col, 0, side, first, apply, cl);
+            first += square_bytes;
+        }
+    } else {
+        for (int row = 0; row < array2m->height; row += side) {
+            map_square(array2m, 0, row, side, first, apply, cl);
+            first += square_bytes;
+        }
+    }
+}
+
+/*
+ * UArray2m_map_quads
+ * Calls apply once for each 2x2 group of cells in Z-order; the four cells
+ * of a group are consecutive in memory
+ * Input: the array (cannot be null), function to apply (cannot be null),
+ *        closure
+ * Output: For valid inputs, void
+ *         For invalid inputs (null array or function), CRE and program exits
+ */
+extern void UArray2m_map_quads(T array2m, UArray2m_quadfun apply, void *cl)
+{
+    assert(array2m != NULL && apply != NULL);
+    unsigned side = array2m->side;
+    size_t square_bytes = (size_t)side * side * array2m->size;
+    char *first = array2m->cells;
+
+    if (side < 2) {
+        return;                 /* a single row or column has no groups */
+    }
+    if (array2m->width > array2m->height) {
+        for (int col = 0; col < array2m->width; col += side) {
+            map_quads_square(array2m, col, 0, side, first, apply, cl);
+            first += square_bytes;
+        }
+    } else {
+        for (int row = 0; row < array2m->height; row += side) {
+            map_quads_square(array2m, 0, row, side, first, apply, cl);
+            first += square_bytes;
+        }
+    }
+}
+
+/*
+ * map_square
+ * Calls apply on the cells of the square of side cells whose top left cell
+ * is at col, row and is stored at first, in Z-order
+ * Input: the array, top left corner of the square, power of two side,
+ *        pointer to the first cell of the square, function and closure
+ * Output: void
+ */
+static void map_square(T array2m, int col, int row, unsigned side,
+                       char *first,
+                       void apply(int col, int row, T array2m, void *elem,
+                                  void *cl),
+                       void *cl)
+{
+    int w = array2m->width;
+    int h = array2m->height;
+    if (col >= w || row >= h) {
+        return;                 /* only padding */
+    }
+
+    size_t size = array2m->size;
+    if (side == 1) {
+        apply(col, row, array2m, first, cl);
+        return;
+    }
+    if (side == 2) {
+        apply(col, row, array2m, first, cl);
+        if (col + 1 < w) {
+            apply(col + 1, row, array2m, first + size, cl);
+        }
+        if (row + 1 < h) {
+            apply(col, row + 1, array2m, first + 2 * size, cl);
+            if (col + 1 < w) {
+                apply(col + 1, row + 1, array2m, first + 3 * size, cl);
+            }
+        }
+        return;
+    }
+
+    unsigned half = side / 2;
+    size_t quarter = (size_t)half * half * size;
+    map_square(array2m, col, row, half, first, apply, cl);
+    map_square(array2m, col + half, row, half, first + quarter, apply, cl);
+    map_square(array2m, col, row + half, half, first + 2 * quarter, apply,
+               cl);
+    map_square(array2m, col + half, row + half, half, first + 3 * quarter,
+               apply, cl);
+}
+
+/*
+ * map_quads_square
+ * Calls apply on the 2x2 groups of the square of side cells whose top left
+ * cell is at col, row and is stored at first, in Z-order
+ * Input: the array, top left corner of the square, power of two side of at
+ *        least 2, pointer to the first cell of the square, function and
+ *        closure
+ * Output: void
+ */
+static void map_quads_square(T array2m, int col, int row, unsigned side,
+                             char *first, UArray2m_quadfun apply, void *cl)
+{
+    /* a group is visited only if all four of its cells are in the array */
+    if (col + 1 >= array2m->width || row + 1 >= array2m->height) {
+        return;
+    }
+
+    size_t size = array2m->size;
+    if (side == 2) {
+        apply(col / 2, row / 2, first, first + size, first + 2 * size,
+              first + 3 * size, cl);
+        return;
+    }
+
+    unsigned half = side / 2;
+    size_t quarter = (size_t)half * half * size;
+    map_quads_square(array2m, col, row, half, first, apply, cl);
+    map_quads_square(array2m, col + half, row, half, first + quarter, apply,
+                     cl);
+    map_quads_square(array2m, col, row + half, half, first + 2 * quarter,
+                     apply, cl);
+    map_quads_square(array2m, col + half, row + half, half,
+                     first + 3 * quarter, apply, cl);
+}
+
+/*
+ * pow2_at_least
+ * Returns the smallest power of two which is at least n (1 for n <= 1)
+ */
+static unsigned pow2_at_least(int n)
+{
+    unsigned pow2 = 1;
+    while (pow2 < (unsigned)n) {
+        pow2 *= 2;
+    }
+    return pow2;
+}
+
+/*
+ * has_fast_pdep
+ * Returns whether the CPU has BMI2, except for AMD Zen 1 and 2, where PDEP
+ * is microcoded and slower than the shifts and masks
+ */
+static bool has_fast_pdep(void)
+{
+#ifdef PDEP_LEVEL
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2") && !__builtin_cpu_is("znver1") &&
+           !__builtin_cpu_is("znver2");
+#else
+    return false;
+#endif
+}
+
+/*
+ * morton
+ * Returns the Z-order index of a cell within a square: the bits of col go
+ * to the even bits of the index and the bits of row to the odd bits
+ */
+static inline uint64_t morton(uint32_t col, uint32_t row)
+{
+    return spread_bits(col) | spread_bits(row) << 1;
+}
+
+#ifdef PDEP_LEVEL
+#pragma GCC push_options
+#pragma GCC target ("bmi2")
+/*
+ * morton_pdep
+ * Returns the same index as morton with one PDEP per coordinate
+ */
+static uint64_t morton_pdep(uint32_t col, uint32_t row)
+{
+    return _pdep_u64(col, 0x5555555555555555) |
+           _pdep_u64(row, 0xAAAAAAAAAAAAAAAA);
+}
+#pragma GCC pop_options
+#endif
+
+/*
+ * spread_bits
+ * Returns x with bit k moved to bit 2k, by moving halves, quarters, ...
+ * apart with shifts and masks
+ */
+static inline uint64_t spread_bits(uint32_t bits)
+{
+    uint64_t x = bits;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFF;
+    x = (x | (x << 8)) & 0x00FF00FF00FF00FF;
+    x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0F;
+    x = (x | (x << 2)) & 0x3333333333333333;
+    x = (x | (x << 1)) & 0x5555555555555555;
+    return x;
+}
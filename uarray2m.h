@@ -0,0 +1,58 @@
+/*
+ * uarray2m.h
+ * Purpose: Interface to a two-dimensional array stored in Morton (Z-order),
+ *          in which every aligned 2x2, 4x4, 8x8, ... square of cells is
+ *          contiguous, so row and column passes both stay local without a
+ *          blocksize to tune
+ */
+#ifndef UARRAY2M_INCLUDED
+#define UARRAY2M_INCLUDED
+
+#define T UArray2m_T
+typedef struct T *T;
+
+/*
+ * UArray2m_quadfun
+ * Work to perform on the 2x2 group of cells whose top left cell is at
+ * column 2 * col, row 2 * row
+ */
+typedef void UArray2m_quadfun(int col, int row, void *tl, void *tr,
+                              void *ll, void *lr, void *cl);
+
+/*
+ * UArray2m_new, UArray2m_free
+ * Create a width by height array of zeroed cells of size bytes, and free
+ * it. Each dimension is padded to a power of two; the padding is address
+ * space that is never touched, not memory that is used.
+ */
+extern T    UArray2m_new (int width, int height, int size);
+extern void UArray2m_free(T *array2m);
+
+extern int UArray2m_width (T array2m);
+extern int UArray2m_height(T array2m);
+extern int UArray2m_size  (T array2m);
+
+/*
+ * UArray2m_at
+ * Returns a pointer to the cell at column col, row row
+ */
+extern void *UArray2m_at(T array2m, int col, int row);
+
+/*
+ * UArray2m_map
+ * Calls apply on every cell in Z-order, which is the order they are stored
+ */
+extern void UArray2m_map(T array2m,
+                         void apply(int col, int row, T array2m,
+                                    void *elem, void *cl),
+                         void *cl);
+
+/*
+ * UArray2m_map_quads
+ * Calls apply once for each 2x2 group of cells in Z-order; a last column or
+ * row of odd width or height is not visited
+ */
+extern void UArray2m_map_quads(T array2m, UArray2m_quadfun apply, void *cl);
+
+#undef T
+#endif
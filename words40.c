@@ -0,0 +1,212 @@
+/*
+ * words40.c
+ * Purpose: Write and read arrays of codewords to and from files as big-endian
+ *          32-bit words in large chunks
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include "assert.h"
+#include "words40.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* number of codewords handed to the OS at a time */
+#define CHUNK_WORDS 4096
+
+static void to_bigendian(const US_TYPE *words, uint32_t *out, int count);
+static void from_bigendian(const uint32_t *in, US_TYPE *words, int count);
+static uint32_t swap_bytes(uint32_t word);
+
+/*
+ * words40_write
+ * Writes count codewords to fp, each as 4 bytes in big-endian order. Words
+ * are narrowed to 32 bits and byte-swapped a chunk at a time, and each chunk
+ * is written with a single fwrite.
+ * Input: File stream pointer (cannot be null), array of count codewords
+ *        (cannot be null unless count is 0)
+ * Output: For valid inputs, void (4 * count bytes written to fp)
+ *         For invalid inputs (null file or words, failed write), CRE and
+ *         program exits
+ */
+void words40_write(FILE *fp, const US_TYPE *words, int count)
+{
+    assert(fp != NULL);
+    assert(words != NULL || count == 0);
+
+    uint32_t chunk[CHUNK_WORDS];
+
+    for (int i = 0; i < count; i += CHUNK_WORDS) {
+        int n = count - i < CHUNK_WORDS ? count - i : CHUNK_WORDS;
+        to_bigendian(&words[i], chunk, n);
+
+        size_t written = fwrite(chunk, sizeof(*chunk), n, fp);
+        assert(written == (size_t)n);
+    }
+}
+
+/*
+ * words40_read
+ * Reads count codewords from fp, each stored as 4 bytes in big-endian order.
+ * Each chunk of words is read with a single fread, then byte-swapped and 
+ * widened into words.
+ * Input: File stream pointer (cannot be null), array of count codewords to
+ *        fill (cannot be null unless count is 0)
+ * Output: For valid inputs, void (words holds the codewords read)
+ *         For invalid inputs (null file or words, file too short), CRE and
+ *         program exits
+ */
+void words40_read(FILE *fp, US_TYPE *words, int count)
+{
+    assert(fp != NULL);
+    assert(words != NULL || count == 0);
+
+    uint32_t chunk[CHUNK_WORDS];
+
+    for (int i = 0; i < count; i += CHUNK_WORDS) {
+        int n = count - i < CHUNK_WORDS ? count - i : CHUNK_WORDS;
+
+        size_t read = fread(chunk, sizeof(*chunk), n, fp);
+        assert(read == (size_t)n); /* check if supplied file is too short */
+
+        from_bigendian(chunk, &words[i], n);
+    }
+}
+
+/*
+ * words40_load
+ * Reads the rest of fp, which must hold exactly count codewords, into a new
+ * buffer of big-endian 32-bit words. When fp is a regular file its length is
+ * checked before anything is read; otherwise the payload is read with one
+ * fread and the file must then be at its end.
+ * Input: File stream pointer (cannot be null), number of codewords expected
+ * Output: For valid inputs, the buffer of count words (the caller frees it)
+ *         For invalid inputs (null file, file too short or too long, out of
+ *         memory), CRE and program exits
+ */
+uint32_t *words40_load(FILE *fp, size_t count)
+{
+    assert(fp != NULL);
+
+    size_t bytes = count * sizeof(uint32_t);
+    struct stat info;
+    if (fstat(fileno(fp), &info) == 0 && S_ISREG(info.st_mode)) {
+        long offset = ftell(fp);
+        assert(offset >= 0);
+        assert((size_t)(info.st_size - offset) == bytes);
+    }
+
+    uint32_t *payload = malloc(bytes > 0 ? bytes : 1);
+    assert(payload != NULL);
+
+    size_t read = fread(payload, sizeof(uint32_t), count, fp);
+    assert(read == count);  /* check if supplied file is too short */
+    int c = getc(fp);
+    assert(c == EOF);       /* ... or has bytes after the last word */
+
+    return payload;
+}
+
+/*
+ * words40_unpack
+ * Converts count big-endian 32-bit words into codewords
+ * Input: array of count 32-bit words (cannot be null unless count is 0),
+ *        array of count codewords to fill (same)
+ * Output: For valid inputs, void (words holds the codewords)
+ *         For invalid inputs (null arrays), CRE and program exits
+ */
+void words40_unpack(const uint32_t *in, US_TYPE *words, int count)
+{
+    assert((in != NULL && words != NULL) || count == 0);
+
+    from_bigendian(in, words, count);
+}
+
+/*
+ * to_bigendian
+ * Narrows count codewords to 32 bits and stores them in out with their bytes
+ * in big-endian order. Four words are handled per step with SSE2 where
+ * available.
+ * Input: array of count codewords, array of count 32-bit words to fill
+ * Output: void (out holds the swapped words)
+ */
+static void to_bigendian(const US_TYPE *words, uint32_t *out, int count)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    for (; i + 4 <= count; i += 4) {
+        __m128i lo = _mm_loadu_si128((const __m128i *)&words[i]);
+        __m128i hi = _mm_loadu_si128((const __m128i *)&words[i + 2]);
+
+        /* keep the low 32 bits of each 64-bit word */
+        lo = _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 0, 2, 0));
+        hi = _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128i x = _mm_unpacklo_epi64(lo, hi);
+
+        /* swap the bytes of each 16-bit half, then swap the halves */
+        x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+        x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+
+        _mm_storeu_si128((__m128i *)&out[i], x);
+    }
+#endif
+
+    for (; i < count; i++) {
+        out[i] = swap_bytes((uint32_t)words[i]);
+    }
+}
+
+/*
+ * from_bigendian
+ * Converts count 32-bit words stored in big-endian order into codewords.
+ * Four words are handled per step with SSE2 where available.
+ * Input: array of count 32-bit words, array of count codewords to fill
+ * Output: void (words holds the converted codewords)
+ */
+static void from_bigendian(const uint32_t *in, US_TYPE *words, int count)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    __m128i zero = _mm_setzero_si128();
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)&in[i]);
+
+        /* swap the bytes of each 16-bit half, then swap the halves */
+        x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+        x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+
+        /* widen each 32-bit word to 64 bits */
+        _mm_storeu_si128((__m128i *)&words[i], _mm_unpacklo_epi32(x, zero));
+        _mm_storeu_si128((__m128i *)&words[i + 2], 
+                         _mm_unpackhi_epi32(x, zero));
+    }
+#endif
+
+    for (; i < count; i++) {
+        words[i] = swap_bytes(in[i]);
+    }
+}
+
+/*
+ * swap_bytes
+ * Reverses the order of the bytes of a 32-bit word on little-endian hosts, so
+ * that the word is laid out in memory in big-endian order
+ * Input: the word to swap
+ * Output: the swapped word
+ */
+static uint32_t swap_bytes(uint32_t word)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return word;
+#endif
+    return (word << 24) | ((word << 8) & 0x00ff0000) |
+           ((word >> 8) & 0x0000ff00) | (word >> 24);
+}
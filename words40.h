@@ -0,0 +1,41 @@
+/*
+ * words40.h
+ * Purpose: Interface to write and read arrays of codewords to and from files
+ *          as big-endian 32-bit words in large chunks
+ */
+#ifndef WORDS40_INCLUDED
+#define WORDS40_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define US_TYPE uint64_t
+
+/*
+ * words40_write
+ * Writes count codewords to fp, each as 4 bytes in big-endian order
+ */
+void words40_write(FILE *fp, const US_TYPE *words, int count);
+
+/*
+ * words40_read
+ * Reads count codewords from fp, each stored as 4 bytes in big-endian order
+ */
+void words40_read(FILE *fp, US_TYPE *words, int count);
+
+/*
+ * words40_load
+ * Reads the rest of fp, which must hold exactly count codewords, into a new
+ * buffer of big-endian 32-bit words with one fread. The caller frees the
+ * buffer.
+ */
+uint32_t *words40_load(FILE *fp, size_t count);
+
+/*
+ * words40_unpack
+ * Converts count big-endian 32-bit words, as loaded by words40_load, into
+ * codewords
+ */
+void words40_unpack(const uint32_t *in, US_TYPE *words, int count);
+
+#endif
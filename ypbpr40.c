@@ -0,0 +1,171 @@
+/*
+ * ypbpr40.c
+ * Purpose: Lookup tables which convert rgb samples to component video 
+ *          (Y/Pb/Pr) with table loads and adds. Each thread keeps the tables 
+ *          for the last few denominators it used, so a batch of images with
+ *          the same denominator builds its table only once per thread.
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "assert.h"
+#include "ypbpr40.h"
+
+#define MAX_DENOMINATOR 65535
+#define CACHE_SIZE 4            /* tables kept by each thread */
+
+/* a table and its terms in one allocation */
+typedef struct cached_table {
+    ypbpr_table table;
+    ypbpr_terms terms[];
+}cached_table;
+
+/* the tables of one thread, most recently used first */
+typedef struct table_cache {
+    cached_table *slots[CACHE_SIZE];
+}table_cache;
+
+static pthread_key_t cache_key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+
+static void make_key(void);
+static void free_cache(void *cache);
+static table_cache *thread_cache(void);
+static cached_table *build_table(int denom);
+
+/*
+ * ypbpr40_table
+ * Returns the table for the given denominator from the cache of the calling
+ * thread, building it if the thread has not used the denominator recently
+ * Input: denominator of the image (1 to 65535)
+ * Output: For valid inputs, the table, which stays valid until the calling 
+ *         thread asks for CACHE_SIZE other denominators or exits
+ *         For invalid inputs (bad denominator, out of memory), CRE and 
+ *         program exits
+ */
+const ypbpr_table *ypbpr40_table(int denom)
+{
+    table_cache *cache = thread_cache();
+    cached_table *found = cache->slots[0];
+
+    if (found != NULL && found->table.denominator == denom) {
+        return &found->table;
+    }
+    assert(denom > 0 && denom <= MAX_DENOMINATOR);
+
+    int i = 1;
+    while (i < CACHE_SIZE && cache->slots[i] != NULL && 
+           cache->slots[i]->table.denominator != denom) {
+        i++;
+    }
+
+    if (i < CACHE_SIZE && cache->slots[i] != NULL) {
+        found = cache->slots[i];
+    } else {
+        /* evict the least recently used table if the cache is full */
+        i = CACHE_SIZE - 1;
+        free(cache->slots[i]);
+        found = build_table(denom);
+    }
+
+    /* move the table to the front */
+    for (; i > 0; i--) {
+        cache->slots[i] = cache->slots[i - 1];
+    }
+    cache->slots[0] = found;
+
+    return &found->table;
+}
+
+/*
+ * make_key
+ * Creates the key under which each thread stores its cache
+ * Input: none
+ * Output: void (cache_key is created)
+ */
+static void make_key(void)
+{
+    int failed = pthread_key_create(&cache_key, free_cache);
+    assert(!failed);
+}
+
+/*
+ * free_cache
+ * Frees the cache of a thread and its tables when the thread exits
+ * Input: the cache
+ * Output: void
+ */
+static void free_cache(void *cache)
+{
+    table_cache *tables = cache;
+
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        free(tables->slots[i]);
+    }
+    free(tables);
+}
+
+/*
+ * thread_cache
+ * Returns the cache of the calling thread, creating an empty one the first 
+ * time the thread asks
+ * Input: none
+ * Output: the cache of the thread
+ *         If memory runs out, CRE and program exits
+ */
+static table_cache *thread_cache(void)
+{
+    pthread_once(&key_once, make_key);
+
+    table_cache *cache = pthread_getspecific(cache_key);
+    if (cache == NULL) {
+        cache = calloc(1, sizeof(*cache));
+        assert(cache != NULL);
+        pthread_setspecific(cache_key, cache);
+    }
+    return cache;
+}
+
+/*
+ * build_table
+ * Builds the table for a denominator. Each term is the coefficient of 
+ * rgb_to_cv times the sample divided by the denominator in float, exactly 
+ * the product rgb_to_cv used to compute; subtracted terms are stored
+ * negated, which adds to the same result.
+ * Input: denominator of the image
+ * Output: For valid inputs, a new table
+ *         If memory runs out, CRE and program exits
+ */
+static cached_table *build_table(int denom)
+{
+    int num_samples = denom + 1;
+    cached_table *cached = malloc(sizeof(*cached) + 
+                                  3 * num_samples * sizeof(ypbpr_terms));
+    assert(cached != NULL);
+
+    ypbpr_terms *red = cached->terms;
+    ypbpr_terms *green = red + num_samples;
+    ypbpr_terms *blue = green + num_samples;
+
+    for (int sample = 0; sample <= denom; sample++) {
+        float value = (float) sample / (float) denom;
+
+        red[sample].y = 0.299 * value;
+        red[sample].pb = -0.168736 * value;
+        red[sample].pr = 0.5 * value;
+
+        green[sample].y = 0.587 * value;
+        green[sample].pb = -(0.331264 * value);
+        green[sample].pr = -(0.418688 * value);
+
+        blue[sample].y = 0.114 * value;
+        blue[sample].pb = 0.5 * value;
+        blue[sample].pr = -(0.081312 * value);
+    }
+
+    cached->table.denominator = denom;
+    cached->table.red = red;
+    cached->table.green = green;
+    cached->table.blue = blue;
+    return cached;
+}
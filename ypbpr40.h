@@ -0,0 +1,40 @@
+/*
+ * ypbpr40.h
+ * Purpose: Interface to lookup tables which convert rgb samples to component
+ *          video (Y/Pb/Pr) with table loads and adds instead of divides and
+ *          multiplies. Each thread keeps the tables for its last few 
+ *          denominators, so later images with the same denominator reuse
+ *          them.
+ */
+#ifndef YPBPR40_INCLUDED
+#define YPBPR40_INCLUDED
+
+/* contribution of one sample of one channel to the Y, Pb and Pr of a pixel */
+typedef struct ypbpr_terms {
+    double y, pb, pr;
+}ypbpr_terms;
+
+/* 
+ * the terms of every sample from 0 to denominator for each channel; the Y of
+ * a pixel is red[r].y + green[g].y + blue[b].y added in that order, and the 
+ * same for Pb and Pr
+ */
+typedef struct ypbpr_table {
+    int denominator;
+    const ypbpr_terms *red;
+    const ypbpr_terms *green;
+    const ypbpr_terms *blue;
+}ypbpr_table;
+
+/*
+ * ypbpr40_table
+ * Returns the table for the given denominator, building it if the calling
+ * thread has not used the denominator recently. The sums of the terms are 
+ * bit-for-bit the same as computing the transform in double from samples 
+ * divided by the denominator in float. The table belongs to the calling 
+ * thread and stays valid until it asks for several other denominators, so
+ * it should be looked up again for each row or image.
+ */
+const ypbpr_table *ypbpr40_table(int denom);
+
+#endif